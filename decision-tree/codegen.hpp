@@ -0,0 +1,159 @@
+#pragma once
+#include "compiled_tree.hpp"
+#include <iomanip>
+#include <ostream>
+
+namespace qy::ai {
+
+	/// @brief Options for emitting a tree as C++ source.
+	struct CodegenOptions {
+		enum Style {
+			SWITCH,	// Nested switch / if statements, one per node
+			TABLE,	// constexpr node table walked by a loop, for trees too large to inline
+		};
+		std::string namespace_name = "model";
+		Style style = SWITCH;
+	};
+
+	namespace detail {
+
+		inline void write_literal(std::ostream& os, std::string_view s) {
+			static constexpr char hex[] = "0123456789abcdef";
+			os << '"';
+			for (unsigned char c : s) {
+				if (c == '"' || c == '\\') os << '\\' << c;
+				else if (c < 0x20 || c >= 0x7f) os << "\\x" << hex[c >> 4] << hex[c & 15] << "\"\"";
+				else os << c;
+			}
+			os << '"';
+		}
+
+		inline void write_switch(std::ostream& os, const CompiledTree& tree, uint32_t id, int depth) {
+			auto indent = [&](int d) { for (int i = 0; i < d; i++) os << '\t'; };
+			auto& node = tree.nodes()[id];
+			if (node.is_leaf()) {
+				indent(depth);
+				os << "return " << (node.value ? "true" : "false") << ";\n";
+				return;
+			}
+			auto child = [&](size_t v) {
+				return v < node.child_count ? tree.children()[node.children + v] : CompiledTree::NONE;
+			};
+			auto body = [&](uint32_t c, int d) {
+				if (c == CompiledTree::NONE) {
+					indent(d);
+					os << "return " << (node.value ? "true" : "false") << ";\n";
+				} else {
+					write_switch(os, tree, c, d);
+				}
+			};
+			if (node.numeric) {
+				indent(depth);
+				os << "if (row[" << node.feature << "] > " << node.threshold << ") {\n";
+				body(child(1), depth + 1);
+				indent(depth);
+				os << "} else {\n";
+				body(child(0), depth + 1);
+				indent(depth);
+				os << "}\n";
+				return;
+			}
+			indent(depth);
+			os << "switch (static_cast<uint32_t>(row[" << node.feature << "])) {\n";
+			for (uint32_t v = 0; v < node.child_count; v++) {
+				if (child(v) == CompiledTree::NONE) continue;
+				indent(depth);
+				os << "case " << v << ": {\n";
+				body(child(v), depth + 1);
+				indent(depth);
+				os << "}\n";
+			}
+			indent(depth);
+			os << "default:\n";
+			body(CompiledTree::NONE, depth + 1);
+			indent(depth);
+			os << "}\n";
+		}
+
+	} // namespace detail
+
+	/// @brief Emit a tree as a standalone C++ header.
+	/// The header defines, in the given namespace, the attribute names, the value dictionary of each
+	/// categorical attribute, and a constexpr classify(row) where row[j] is the code of attribute j in
+	/// its dictionary, or its value for numeric attributes. Unknown codes fall back like the tree does.
+	inline void write_cpp(std::ostream& os, const CompiledTree& tree, const CodegenOptions& options = {}) {
+		const Schema& schema = tree.schema();
+		auto flags = os.flags();
+		auto precision = os.precision();
+		os << std::setprecision(17);
+		os << "// Generated from a trained decision tree. Do not edit.\n"
+			<< "#pragma once\n#include <array>\n#include <cstdint>\n#include <string_view>\n\n"
+			<< "namespace " << options.namespace_name << " {\n\n";
+
+		os << "\tconstexpr std::string_view label_name = ";
+		detail::write_literal(os, schema.label_name);
+		// std::array rather than a built-in array, which cannot be empty
+		size_t count = schema.attributes.size();
+		os << ";\n\tconstexpr std::array<std::string_view, " << count << "> attributes = {";
+		for (size_t j = 0; j < count; j++) {
+			os << (j ? ", " : " ");
+			detail::write_literal(os, schema.attributes[j]);
+		}
+		os << " };\n";
+		os << "\tconstexpr std::array<bool, " << count << "> numeric = {";
+		for (size_t j = 0; j < count; j++)
+			os << (j ? ", " : " ") << (schema.is_numeric(j) ? "true" : "false");
+		os << " };\n\n";
+		for (size_t j = 0; j < count; j++) {
+			const Dictionary& dict = schema.dictionaries[j];
+			if (schema.is_numeric(j) || dict.size() == 0) continue;
+			os << "\t/// Codes of attribute " << j << "\n\tconstexpr std::array<std::string_view, " << dict.size()
+				<< "> values_" << j << " = {";
+			for (code_t v = 0; v < dict.size(); v++) {
+				os << (v ? ", " : " ");
+				detail::write_literal(os, dict.decode(v));
+			}
+			os << " };\n";
+		}
+
+		if (options.style == CodegenOptions::SWITCH) {
+			// A single leaf never reads the row
+			os << "\n\ttemplate <class Row>\n\tconstexpr bool classify([[maybe_unused]] const Row& row) {\n";
+			detail::write_switch(os, tree, 0, 2);
+			os << "\t}\n";
+		} else {
+			os << "\n\tstruct Node {\n\t\tdouble threshold;\n\t\tint32_t feature;\n\t\tuint32_t children;\n"
+				<< "\t\tuint32_t child_count;\n\t\tbool value;\n\t\tbool numeric;\n\t};\n\n"
+				<< "\tconstexpr uint32_t NONE = UINT32_MAX;\n\n\tconstexpr Node nodes[] = {\n";
+			for (auto&& n : tree.nodes()) {
+				os << "\t\t{ " << n.threshold << ", " << n.feature << ", " << n.children << ", " << n.child_count
+					<< ", " << (n.value ? "true" : "false") << ", " << (n.numeric ? "true" : "false") << " },\n";
+			}
+			os << "\t};\n\n\tconstexpr uint32_t children[] = {";
+			for (size_t i = 0; i < tree.children().size(); i++) {
+				uint32_t c = tree.children()[i];
+				os << (i % 16 ? " " : "\n\t\t");
+				if (c == CompiledTree::NONE) os << "NONE,";
+				else os << c << ",";
+			}
+			if (tree.children().empty()) os << " NONE";
+			os << "\n\t};\n\n"
+				<< "\ttemplate <class Row>\n\tconstexpr bool classify(const Row& row) {\n"
+				<< "\t\tconst Node* node = &nodes[0];\n"
+				<< "\t\twhile (node->feature >= 0) {\n"
+				<< "\t\t\tuint32_t c = node->numeric ? row[node->feature] > node->threshold : static_cast<uint32_t>(row[node->feature]);\n"
+				<< "\t\t\tuint32_t next = c < node->child_count ? children[node->children + c] : NONE;\n"
+				<< "\t\t\tif (next == NONE)\n\t\t\t\treturn node->value;\n"
+				<< "\t\t\tnode = &nodes[next];\n"
+				<< "\t\t}\n\t\treturn node->value;\n\t}\n";
+		}
+		os << "\n} // namespace " << options.namespace_name << "\n";
+		os.flags(flags);
+		os.precision(precision);
+	}
+
+	inline void write_cpp(std::ostream& os, const DecisionTree& tree, const CodegenOptions& options = {}) {
+		write_cpp(os, CompiledTree(tree), options);
+	}
+
+} // namespace qy::ai
@@ -0,0 +1,366 @@
+#pragma once
+#include "decision_tree.hpp"
+#include "csv_loader.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <thread>
+
+namespace qy::ai {
+
+	/// @brief Inference form of a DecisionTree. Nodes are stored in one contiguous array in depth-first
+	/// order with integer features, and the children of each node are a small slice of a shared table.
+	/// Batch classification walks the tree once per block of rows, partitioning the block by child at
+	/// every node, so each visit reads one column for many rows.
+	///
+	/// Models are saved in a versioned binary format: a header, the node array and the child table
+	/// exactly as laid out in memory, then the schema (attribute names, numeric flags and value
+	/// dictionaries). load() maps the file and uses the nodes in place; only the schema is parsed.
+	class CompiledTree {
+	public:
+		static constexpr uint32_t NONE = UINT32_MAX;	// Missing child, rows fall back to the node's value
+		static constexpr size_t BLOCK_ROWS = 4096;
+		static constexpr size_t SMALL_GROUP = 32;	// Nodes with under (child_count + SMALL_GROUP) / 4 rows walk them one by one
+
+		struct FlatNode {
+			double threshold;	// Numeric splits send values <= threshold to the first child
+			int32_t feature;	// Index of the split attribute, -1 for leaves
+			uint32_t children;	// Offset of the child table
+			uint32_t child_count;
+			uint8_t value;	// Label of leaves, plurality of internal nodes
+			uint8_t numeric;
+			uint16_t reserved;
+
+			bool is_leaf() const { return feature < 0; }
+		};
+		static_assert(sizeof(FlatNode) == 24);
+
+		static constexpr char MAGIC[4] = { 'Q', 'Y', 'D', 'T' };
+		static constexpr uint32_t VERSION = 1;
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint64_t attributes;
+			uint64_t nodes;
+			uint64_t children;
+			uint64_t nodes_offset;
+			uint64_t children_offset;
+			uint64_t schema_offset;
+		};
+		static_assert(sizeof(Header) % alignof(FlatNode) == 0);
+
+		explicit CompiledTree(const DecisionTree& tree): CompiledTree(tree, std::make_shared<const Schema>(tree.schema())) {}
+
+		/// @param schema The tree's schema, shared with other trees on the same data such as the
+		/// members of a forest.
+		CompiledTree(const DecisionTree& tree, std::shared_ptr<const Schema> schema): _schema(std::move(schema)) {
+			add(tree.root());
+			_nodes = _node_storage;
+			_children = _child_storage;
+		}
+
+		// Nodes may point into owned storage, which moves along but is not re-pointed by a copy
+		CompiledTree(CompiledTree&&) = default;
+		CompiledTree& operator= (CompiledTree&&) = default;
+		CompiledTree(const CompiledTree&) = delete;
+		CompiledTree& operator= (const CompiledTree&) = delete;
+
+		/// @brief Write the model to a file.
+		void save(const fs::path& path) const {
+			std::string schema = encode_schema();
+			uint64_t nodes_offset = sizeof(Header);
+			uint64_t children_offset = nodes_offset + _nodes.size_bytes();
+			uint64_t schema_offset = children_offset + _children.size_bytes();
+			Header h{ {}, VERSION, _schema->attributes.size(), _nodes.size(), _children.size(),
+				nodes_offset, children_offset, schema_offset };
+			std::memcpy(h.magic, MAGIC, 4);
+			std::ofstream out(path, std::ios::binary);
+			if (out.fail())
+				throw std::runtime_error("Cannot write file: " + path.string());
+			out.write((const char*)&h, sizeof(h));
+			out.write((const char*)_nodes.data(), _nodes.size_bytes());
+			out.write((const char*)_children.data(), _children.size_bytes());
+			out.write(schema.data(), schema.size());
+			if (!out)
+				throw std::runtime_error("Write failed: " + path.string());
+		}
+
+		/// @brief Map a saved model. Nodes are used in place in the mapping.
+		static CompiledTree load(const fs::path& path) {
+			CompiledTree tree;
+			tree._file = std::make_shared<MappedFile>(path);
+			std::string_view file = tree._file->view();
+			auto malformed = [&] { return std::runtime_error("Malformed model: " + path.string()); };
+			Header h;
+			if (file.size() < sizeof(h))
+				throw malformed();
+			std::memcpy(&h, file.data(), sizeof(h));
+			if (std::memcmp(h.magic, MAGIC, 4) != 0 || h.version != VERSION)
+				throw malformed();
+			if (h.nodes == 0 || h.nodes_offset % alignof(FlatNode) != 0
+				|| h.nodes_offset > file.size() || h.nodes > (file.size() - h.nodes_offset) / sizeof(FlatNode)
+				|| h.children_offset != h.nodes_offset + h.nodes * sizeof(FlatNode)
+				|| h.children > (file.size() - h.children_offset) / sizeof(uint32_t)
+				|| h.schema_offset != h.children_offset + h.children * sizeof(uint32_t))
+				throw malformed();
+			tree._nodes = { (const FlatNode*)(file.data() + h.nodes_offset), h.nodes };
+			tree._children = { (const uint32_t*)(file.data() + h.children_offset), h.children };
+
+			std::string_view schema = file.substr(h.schema_offset);
+			Schema s;
+			if (!get_string(schema, s.label_name))
+				throw malformed();
+			s.attributes.resize(h.attributes);
+			s.numeric.resize(h.attributes);
+			s.dictionaries.resize(h.attributes);
+			for (size_t j = 0; j < h.attributes; j++) {
+				uint32_t size;
+				if (!get_string(schema, s.attributes[j]) || schema.empty())
+					throw malformed();
+				s.numeric[j] = schema[0];
+				schema.remove_prefix(1);
+				if (!get_u32(schema, size))
+					throw malformed();
+				std::string value;
+				for (uint32_t v = 0; v < size; v++) {
+					if (!get_string(schema, value))
+						throw malformed();
+					s.dictionaries[j].encode(value);
+				}
+			}
+			tree._schema = std::make_shared<const Schema>(std::move(s));
+			if (!tree.valid())
+				throw malformed();
+			return tree;
+		}
+
+		/// @brief Set the number of threads for batch classification, 0 for all cores.
+		void set_threads(unsigned threads) { _threads = threads; }
+
+		const Schema& schema() const { return *_schema; }
+		std::span<const FlatNode> nodes() const { return _nodes; }
+		std::span<const uint32_t> children() const { return _children; }
+
+		bool classify(const Example& example) const {
+			const FlatNode* node = &_nodes[0];
+			while (!node->is_leaf()) {
+				const std::string& raw = example.data.at(_schema->attributes[node->feature]);
+				size_t c;
+				if (node->numeric) {
+					double x;
+					if (!parse_number(raw, x))
+						return node->value;
+					c = x > node->threshold;
+				} else {
+					c = _schema->dictionaries[node->feature].find(raw);
+				}
+				uint32_t next = c < node->child_count ? _children[node->children + c] : NONE;
+				if (next == NONE)
+					return node->value;
+				node = &_nodes[next];
+			}
+			return node->value;
+		}
+
+		/// @brief Classify a row of data encoded with this tree's schema.
+		bool classify(const EncodedDataset& data, size_t row) const {
+			return descend(data, row, 0);
+		}
+
+		/// @brief Classify a row of data starting from a node.
+		bool descend(const EncodedDataset& data, size_t row, uint32_t id) const {
+			const FlatNode* node = &_nodes[id];
+			while (!node->is_leaf()) {
+				const Column& column = data.column(node->feature);
+				size_t c = node->numeric ? column.number(row) > node->threshold : column[row];
+				uint32_t next = c < node->child_count ? _children[node->children + c] : NONE;
+				if (next == NONE)
+					return node->value;
+				node = &_nodes[next];
+			}
+			return node->value;
+		}
+
+		/// @brief Classify all rows of data encoded with this tree's schema.
+		/// Row blocks are split across set_threads() threads.
+		std::vector<int> classify(const EncodedDataset& data) const {
+			std::vector<int> result(data.size());
+			size_t blocks = (data.size() + BLOCK_ROWS - 1) / BLOCK_ROWS;
+			unsigned threads = _threads ? _threads : std::max(1u, std::thread::hardware_concurrency());
+			threads = std::min<size_t>(threads, blocks);
+			auto run = [&](size_t t) {
+				std::vector<uint32_t> rows, scratch;
+				for (size_t b = t; b < blocks; b += threads) {
+					size_t begin = b * BLOCK_ROWS, end = std::min(data.size(), begin + BLOCK_ROWS);
+					classify_block(data, begin, end, result.data() + begin, rows, scratch);
+				}
+			};
+			if (threads <= 1) {
+				run(0);
+			} else {
+				std::vector<std::thread> workers;
+				for (size_t t = 0; t < threads; t++)
+					workers.emplace_back(run, t);
+				for (auto&& w : workers)
+					w.join();
+			}
+			return result;
+		}
+
+		/// @brief Classify rows [begin, end) into out[0, end - begin) on the calling thread,
+		/// partitioning their indices by child at every node. rows and scratch are reusable buffers.
+		void classify_block(const EncodedDataset& data, size_t begin, size_t end, int* out,
+			std::vector<uint32_t>& rows, std::vector<uint32_t>& scratch) const {
+			struct Task { uint32_t node, first, last; };
+			rows.resize(end - begin);
+			scratch.resize(end - begin);
+			std::iota(rows.begin(), rows.end(), (uint32_t)begin);
+			std::vector<Task> stack{ { 0, 0, (uint32_t)rows.size() } };
+			std::vector<uint32_t> bounds, pos;
+			auto fill = [&](uint32_t first, uint32_t last, int value) {
+				for (uint32_t i = first; i < last; i++)
+					out[rows[i] - begin] = value;
+			};
+			while (!stack.empty()) {
+				auto [id, first, last] = stack.back();
+				stack.pop_back();
+				const FlatNode& node = _nodes[id];
+				if (node.is_leaf()) {
+					fill(first, last, node.value);
+					continue;
+				}
+				if ((last - first) * 4 < node.child_count + SMALL_GROUP) {
+					// Too few rows to pay for a partition
+					for (uint32_t i = first; i < last; i++)
+						out[rows[i] - begin] = descend(data, rows[i], id);
+					continue;
+				}
+				const uint32_t* next = &_children[node.children];
+				const Column& column = data.column(node.feature);
+				if (node.numeric) {
+					auto values = column.numbers();
+					uint32_t mid = std::partition(rows.data() + first, rows.data() + last,
+						[&](uint32_t r) { return !(values[r] > node.threshold); }) - rows.data();
+					bounds.assign({ first, mid, last });
+				} else {
+					// Counting sort by code, unknown codes go to a last bucket
+					size_t k = node.child_count;
+					bounds.assign(k + 2, 0);
+					column.visit([&](auto codes) {
+						for (uint32_t i = first; i < last; i++)
+							++bounds[std::min<size_t>(codes[rows[i]], k) + 1];
+						bounds[0] = first;
+						for (size_t v = 0; v <= k; v++)
+							bounds[v + 1] += bounds[v];
+						pos.assign(bounds.begin(), bounds.end() - 1);
+						for (uint32_t i = first; i < last; i++)
+							scratch[pos[std::min<size_t>(codes[rows[i]], k)]++] = rows[i];
+					});
+					std::copy(scratch.begin() + first, scratch.begin() + last, rows.begin() + first);
+				}
+				for (size_t v = 0; v + 1 < bounds.size(); v++) {
+					if (bounds[v] == bounds[v + 1]) continue;
+					if (v < node.child_count && next[v] != NONE)
+						stack.push_back({ next[v], bounds[v], bounds[v + 1] });
+					else
+						fill(bounds[v], bounds[v + 1], node.value);
+				}
+			}
+		}
+
+		/// @brief Size of the saved model in bytes.
+		size_t byte_size() const {
+			return sizeof(Header) + _nodes.size_bytes() + _children.size_bytes() + encode_schema().size();
+		}
+
+	private:
+		CompiledTree() = default;
+
+		std::string encode_schema() const {
+			std::string schema;
+			put_string(schema, _schema->label_name);
+			for (size_t j = 0; j < _schema->attributes.size(); j++) {
+				put_string(schema, _schema->attributes[j]);
+				schema.push_back(_schema->is_numeric(j));
+				const Dictionary& dict = _schema->dictionaries[j];
+				put_u32(schema, dict.size());
+				for (code_t v = 0; v < dict.size(); v++)
+					put_string(schema, dict.decode(v));
+			}
+			return schema;
+		}
+
+		static void put_u32(std::string& out, uint32_t x) {
+			out.append((const char*)&x, sizeof(x));
+		}
+
+		static void put_string(std::string& out, std::string_view s) {
+			put_u32(out, s.size());
+			out.append(s);
+		}
+
+		static bool get_u32(std::string_view& in, uint32_t& x) {
+			if (in.size() < sizeof(x)) return false;
+			std::memcpy(&x, in.data(), sizeof(x));
+			in.remove_prefix(sizeof(x));
+			return true;
+		}
+
+		static bool get_string(std::string_view& in, std::string& s) {
+			uint32_t n;
+			if (!get_u32(in, n) || in.size() < n) return false;
+			s.assign(in.substr(0, n));
+			in.remove_prefix(n);
+			return true;
+		}
+
+		/// @brief Check that every feature and child reference of a loaded model is in range.
+		bool valid() const {
+			for (auto&& node : _nodes) {
+				if (node.is_leaf()) continue;
+				if ((size_t)node.feature >= _schema->attributes.size()
+					|| node.numeric != _schema->is_numeric(node.feature)
+					|| node.children > _children.size() || node.child_count > _children.size() - node.children)
+					return false;
+				for (uint32_t v = 0; v < node.child_count; v++) {
+					uint32_t c = _children[node.children + v];
+					if (c != NONE && c >= _nodes.size())
+						return false;
+				}
+			}
+			return true;
+		}
+
+		/// @brief Append a subtree in depth-first order.
+		/// @return Index of its root.
+		uint32_t add(const DecisionTree::Node* node) {
+			uint32_t id = _node_storage.size();
+			_node_storage.push_back({ node->threshold, node->feature, 0, 0, node->value, 0, 0 });
+			if (node->is_leaf())
+				return id;
+			uint32_t offset = _child_storage.size();
+			_node_storage[id].numeric = _schema->is_numeric(node->feature);
+			_node_storage[id].children = offset;
+			_node_storage[id].child_count = node->children.size();
+			_child_storage.resize(offset + node->children.size(), NONE);
+			for (size_t v = 0; v < node->children.size(); v++) {
+				if (node->children[v]) {
+					uint32_t child = add(node->children[v]);
+					_child_storage[offset + v] = child;
+				}
+			}
+			return id;
+		}
+
+		std::shared_ptr<const Schema> _schema;	// Shared by the trees of a forest
+		std::span<const FlatNode> _nodes;
+		std::span<const uint32_t> _children;
+		std::vector<FlatNode> _node_storage;	// Backs the spans of a compiled tree
+		std::vector<uint32_t> _child_storage;
+		std::shared_ptr<const MappedFile> _file;	// Backs the spans of a loaded tree
+		unsigned _threads = 0;
+	};
+
+} // namespace qy::ai
@@ -0,0 +1,255 @@
+#pragma once
+#include "encoded_dataset.hpp"
+#include <thread>
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define QY_HAVE_MMAP 1
+#endif
+
+namespace qy::ai {
+
+	/// @brief Read-only view of a whole file, memory-mapped where supported.
+	class MappedFile {
+	public:
+		explicit MappedFile(const fs::path& path) {
+#ifdef QY_HAVE_MMAP
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::runtime_error("Cannot read file: " + path.string());
+			struct stat st;
+			if (::fstat(fd, &st) != 0) {
+				::close(fd);
+				throw std::runtime_error("Cannot read file: " + path.string());
+			}
+			_size = st.st_size;
+			if (_size > 0) {
+				void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+				::close(fd);
+				if (p == MAP_FAILED)
+					throw std::runtime_error("Cannot map file: " + path.string());
+				_data = (const char*)p;
+				::madvise(p, _size, MADV_SEQUENTIAL);
+			} else {
+				::close(fd);
+			}
+#else
+			std::ifstream in(path, std::ios::binary);
+			if (in.fail())
+				throw std::runtime_error("Cannot read file: " + path.string());
+			_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			_data = _buffer.data();
+			_size = _buffer.size();
+#endif
+		}
+
+		~MappedFile() {
+#ifdef QY_HAVE_MMAP
+			if (_data) ::munmap((void*)_data, _size);
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator= (const MappedFile&) = delete;
+
+		std::string_view view() const { return { _data, _size }; }
+
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+#ifndef QY_HAVE_MMAP
+		std::string _buffer;
+#endif
+	};
+
+	/// @brief Single-pass CSV loader producing an EncodedDataset directly.
+	/// Fields are parsed as string_views into the mapped file and dictionary-encoded on the fly.
+	/// Large files can be split into line-aligned chunks parsed in parallel; each chunk encodes with
+	/// its own dictionaries, which are merged in chunk order so codes match a serial load.
+	/// Numeric attributes are parsed straight into numbers and skip the dictionaries.
+	class CsvLoader {
+	public:
+		struct Options {
+			bool labeled = true;
+			unsigned threads = 1;	// 0 for all cores
+			size_t min_chunk_bytes = 1 << 20;	// Files smaller than this per thread are parsed serially
+			bool keep_raw = false;	// Also keep the raw text of every row
+			std::vector<attr_t> numeric;	// Attributes to load as numbers, besides those numeric in the base schema
+		};
+
+		explicit CsvLoader(Options options): _options(options) {}
+		CsvLoader(): CsvLoader(Options{}) {}
+
+		/// @brief Load a CSV file with a header line.
+		/// @param base Schema of a previously encoded dataset to stay compatible with, or null.
+		EncodedDataset load(const fs::path& path, const Schema* base = nullptr) {
+			MappedFile file(path);
+			std::string_view text = file.view();
+			size_t header_end = std::min(text.find('\n'), text.size());
+			auto header = split(text.substr(0, header_end));
+
+			Schema schema;
+			if (base) {
+				schema = *base;
+			} else {
+				schema.attributes.assign(header.begin(), header.end());
+				if (_options.labeled && !schema.attributes.empty()) {
+					schema.label_name = schema.attributes.back();
+					schema.attributes.pop_back();
+				}
+			}
+			if (!_options.numeric.empty())
+				schema.set_numeric(_options.numeric);
+			size_t nattr = schema.attributes.size();
+			EncodedDataset result(std::move(schema), _options.labeled);
+			const auto& numeric = result.schema().numeric;
+
+			text.remove_prefix(std::min(header_end + 1, text.size()));
+			auto chunks = make_chunks(text);
+			std::vector<Chunk> parsed(chunks.size());
+			auto parse_one = [&](size_t i) { parsed[i] = parse(chunks[i], numeric); };
+			if (chunks.size() == 1) {
+				parse_one(0);
+			} else {
+				std::vector<std::thread> threads;
+				for (size_t i = 0; i < chunks.size(); i++)
+					threads.emplace_back(parse_one, i);
+				for (auto&& t : threads)
+					t.join();
+			}
+			merge(result, parsed, nattr);
+			return result;
+		}
+
+		/// @brief Raw rows of the last load, if keep_raw was set. Views are copied into owned strings.
+		const std::vector<std::vector<std::string>>& raw_values() const { return _raw_values; }
+
+	private:
+		struct Chunk {
+			std::vector<Dictionary> dictionaries;
+			std::vector<std::vector<code_t>> columns;
+			std::vector<std::vector<double>> numbers;
+			std::vector<char> labels;
+			std::vector<std::vector<std::string>> raw;
+		};
+
+		static std::string_view trim_cr(std::string_view line) {
+			if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+			return line;
+		}
+
+		static std::vector<std::string_view> split(std::string_view line) {
+			std::vector<std::string_view> fields;
+			line = trim_cr(line);
+			for (size_t start = 0; start <= line.size(); ) {
+				size_t end = std::min(line.find(',', start), line.size());
+				fields.push_back(line.substr(start, end - start));
+				start = end + 1;
+			}
+			return fields;
+		}
+
+		std::vector<std::string_view> make_chunks(std::string_view text) const {
+			unsigned threads = _options.threads ? _options.threads : std::max(1u, std::thread::hardware_concurrency());
+			size_t n = std::max<size_t>(1, std::min<size_t>(threads, text.size() / std::max<size_t>(1, _options.min_chunk_bytes)));
+			std::vector<std::string_view> chunks;
+			size_t start = 0;
+			for (size_t i = 1; i <= n && start < text.size(); i++) {
+				size_t end = i == n ? text.size() : text.size() * i / n;
+				if (end < start) end = start;
+				end = std::min(text.find('\n', end), text.size());
+				if (end < text.size()) ++end;
+				chunks.push_back(text.substr(start, end - start));
+				start = end;
+			}
+			if (chunks.empty()) chunks.emplace_back();
+			return chunks;
+		}
+
+		Chunk parse(std::string_view text, const std::vector<char>& numeric) const {
+			size_t nattr = numeric.size();
+			Chunk c;
+			c.dictionaries.resize(nattr);
+			c.columns.resize(nattr);
+			c.numbers.resize(nattr);
+			while (!text.empty()) {
+				size_t end = std::min(text.find('\n'), text.size());
+				std::string_view line = trim_cr(text.substr(0, end));
+				text.remove_prefix(std::min(end + 1, text.size()));
+				if (line.empty()) continue;
+				size_t j = 0, start = 0;
+				bool label = false;
+				while (start <= line.size()) {
+					size_t stop = std::min(line.find(',', start), line.size());
+					std::string_view field = line.substr(start, stop - start);
+					if (j < nattr && numeric[j]) {
+						double x;
+						if (!parse_number(field, x))
+							throw std::runtime_error("Not a number: " + std::string(field));
+						c.numbers[j].push_back(x);
+					} else if (j < nattr) {
+						c.columns[j].push_back(c.dictionaries[j].encode(field));
+					} else if (j == nattr && _options.labeled) {
+						label = field == "1";
+					}
+					++j;
+					start = stop + 1;
+				}
+				if (j < nattr + _options.labeled)
+					throw std::runtime_error("Too few fields in CSV row");
+				c.labels.push_back(label);
+				if (_options.keep_raw) {
+					auto& row = c.raw.emplace_back();
+					for (auto f : split(line)) row.emplace_back(f);
+				}
+			}
+			return c;
+		}
+
+		void merge(EncodedDataset& result, std::vector<Chunk>& chunks, size_t nattr) {
+			_raw_values.clear();
+			size_t rows = 0;
+			for (auto&& c : chunks) rows += c.labels.size();
+			std::vector<code_t> remap;
+			for (size_t j = 0; j < nattr; j++) {
+				if (result._columns[j].numeric()) {
+					std::vector<double> numbers;
+					numbers.reserve(rows);
+					for (auto&& c : chunks) {
+						numbers.insert(numbers.end(), c.numbers[j].begin(), c.numbers[j].end());
+						c.numbers[j] = {};
+					}
+					result._columns[j].assign_numbers(std::move(numbers));
+					continue;
+				}
+				std::vector<code_t> codes;
+				codes.reserve(rows);
+				for (auto&& c : chunks) {
+					auto& local = c.dictionaries[j];
+					remap.resize(local.size());
+					for (code_t v = 0; v < local.size(); v++)
+						remap[v] = result._schema.dictionaries[j].encode(local.decode(v));
+					for (auto v : c.columns[j])
+						codes.push_back(remap[v]);
+					c.columns[j] = {};
+				}
+				result._columns[j].assign(codes);
+			}
+			result._labels.resize(rows);
+			size_t i = 0;
+			for (auto&& c : chunks) {
+				for (char l : c.labels)
+					result._labels.set(i++, l);
+				if (_options.keep_raw)
+					std::ranges::move(c.raw, std::back_inserter(_raw_values));
+			}
+			result._rows = rows;
+		}
+
+		Options _options;
+		std::vector<std::vector<std::string>> _raw_values;
+	};
+
+} // namespace qy::ai
@@ -10,7 +10,8 @@ namespace qy::ai {
 
 	class Dataset {
 	public:
-		Dataset(const fs::path& path, bool labeled) : _labeled(labeled) {
+		/// @param keep_raw Whether to keep the raw values of every row in raw_values.
+		Dataset(const fs::path& path, bool labeled, bool keep_raw = true) : _labeled(labeled) {
 			std::ifstream inFile(path);
 			if (inFile.fail()) {
 				throw std::runtime_error("Cannot read file: " + path.string());
@@ -19,8 +20,10 @@ namespace qy::ai {
 			std::getline(inFile, line);
 			this->attributes = get_values(line);
 			for (int row = 1; std::getline(inFile, line); row++) {
-				this->raw_values.push_back(get_values(line));
-				this->examples.push_back(build_example(get_values(line)));
+				auto values = get_values(line);
+				if (keep_raw)
+					this->raw_values.push_back(values);
+				this->examples.push_back(build_example(std::move(values)));
 			}
 			if (labeled) this->attributes.pop_back();
 		}
@@ -1,11 +1,17 @@
 #pragma once
 #include "example.hpp"
 #include "dataset.hpp"
+#include "encoded_dataset.hpp"
+#include "task_pool.hpp"
 #include <unordered_map>
 #include <algorithm>
 #include <numeric>
 #include <functional>
 #include <cmath>
+#include <deque>
+#include <limits>
+#include <span>
+#include <thread>
 
 namespace qy::ai {
 
@@ -26,33 +32,94 @@ namespace qy::ai {
 			Node(attr_t attribute): Node(attribute, false) {}
 			Node(attr_t attribute, bool value): attribute(std::move(attribute)), value(value) {}
 
-			~Node() {
-				for (auto&& [a, c] : options)
-					delete c;
-			}
+			bool is_leaf() const { return feature < 0; }
 
 			attr_t attribute;
-			bool value; // 当对应的option为null时选择的值
-			std::unordered_map<attr_t, Node*> options;
+			int feature = -1;	// Index of the split attribute, -1 for leaves
+			bool value; // 当对应的child为null时选择的值
+			double threshold = 0;	// Numeric splits send values <= threshold to children[0], others to children[1]
+			std::vector<Node*> children;	// Indexed by value code, or by value > threshold
 		};
 
-		DecisionTree(const Dataset& dataset) {
-			_root = learn(dataset.attributes, dataset.examples);
-		}
+		struct Options {
+			size_t max_features = 0;	// Candidate attributes drawn at random at every node, 0 for all
+			uint64_t seed = 0;	// Seed for drawing candidate attributes
+			unsigned threads = 0;	// Threads for building subtrees and scoring wide nodes, 0 for all cores
+			size_t min_task_rows = 1 << 14;	// Subsets at least this large are built as separate tasks
+			size_t max_depth = 0;	// Nodes at this depth become leaves, 0 for no limit
+			size_t min_leaf_rows = 1;	// Splits may not create a non-empty child with fewer rows
+			double min_gain = 0;	// Splits must gain at least this much information, in bits
+		};
+
+		/// @brief Size of the tree before and after pruning.
+		struct PruneStats {
+			size_t nodes_before, depth_before;
+			size_t nodes_after, depth_after;
+		};
 
-		~DecisionTree() {
-			delete _root;
+		DecisionTree(const Dataset& dataset): DecisionTree(EncodedDataset(dataset)) {}
+
+		DecisionTree(const EncodedDataset& data): DecisionTree(data, Options{}) {}
+
+		/// @param rows Rows to train on, may repeat (e.g. a bootstrap sample). Empty for all rows.
+		DecisionTree(const EncodedDataset& data, Options options, std::span<const uint32_t> rows = {}): _schema(data.schema()) {
+			Builder builder{ *this, data, options };
+			if (rows.empty()) {
+				builder.rows.resize(data.size());
+				std::iota(builder.rows.begin(), builder.rows.end(), 0);
+			} else {
+				builder.rows.assign(rows.begin(), rows.end());
+			}
+			_root = builder.build();
+			for (auto&& c : builder.contexts)
+				_arenas.push_back(std::move(c.arena));
 		}
 
+		// Nodes live in the arenas, which keep their addresses when moved
+		DecisionTree(DecisionTree&&) = default;
+		DecisionTree& operator= (DecisionTree&&) = default;
+		DecisionTree(const DecisionTree&) = delete;
+		DecisionTree& operator= (const DecisionTree&) = delete;
+
 		const Node* root() const { return _root; }
+		const Schema& schema() const { return _schema; }
+		size_t node_count() const { return node_count(_root); }
+		/// @brief Number of edges on the longest path from the root.
+		size_t depth() const { return depth(_root); }
+
+		/// @brief Reduced-error pruning: working bottom-up, replace every subtree by a leaf predicting
+		/// its training plurality when that makes no more errors on the validation rows reaching it.
+		/// Subtrees no validation row reaches are pruned too. Pruned nodes stay in the arenas until the
+		/// tree is destroyed; compile the tree to get a compact model.
+		/// @param validation Data encoded with this tree's schema, usually held out from training.
+		/// @param rows Rows of validation to use, empty for all.
+		PruneStats prune(const EncodedDataset& validation, std::span<const uint32_t> rows = {}) {
+			size_t nodes_before = node_count(), depth_before = depth();
+			std::vector<uint32_t> order(rows.begin(), rows.end());
+			if (rows.empty()) {
+				order.resize(validation.size());
+				std::iota(order.begin(), order.end(), 0);
+			}
+			prune(_root, validation, order.data(), order.data() + order.size());
+			return { nodes_before, depth_before, node_count(), depth() };
+		}
 
 		bool classify(const Example& example) const {
 			const Node* root = _root;
-			while (!root->options.empty()) {
-				auto&& a = example.data.at(root->attribute);
-				if (!root->options.contains(a))
+			while (!root->is_leaf()) {
+				const std::string& raw = example.data.at(root->attribute);
+				size_t c;
+				if (_schema.is_numeric(root->feature)) {
+					double x;
+					if (!parse_number(raw, x))
+						return root->value;
+					c = x > root->threshold;
+				} else {
+					c = _schema.dictionaries[root->feature].find(raw);
+				}
+				if (c >= root->children.size() || !root->children[c])
 					return root->value;
-				root = root->options.at(a);
+				root = root->children[c];
 			}
 			return root->value;
 		}
@@ -64,53 +131,391 @@ namespace qy::ai {
 			return result;
 		}
 
-	private:
-
-		double entropy_remain(attr_t attribute, const ExampleList& examples) const {
-			double result = 0.0;
-			for (auto&& [option, exs] : group_by(examples, attribute)) {
-				int pos = get_positive_count(exs), neg = exs.size() - pos;
-				double p_k = (double)exs.size() / examples.size();
-				double e_k = binary_entropy((double)pos / (pos + neg));
-				result += p_k * e_k;
+		/// @brief Classify a row of data encoded with this tree's schema.
+		bool classify(const EncodedDataset& data, size_t row) const {
+			const Node* root = _root;
+			while (!root->is_leaf()) {
+				const Column& column = data.column(root->feature);
+				size_t c = column.numeric() ? column.number(row) > root->threshold : column[row];
+				if (c >= root->children.size() || !root->children[c])
+					return root->value;
+				root = root->children[c];
 			}
-			return result;
+			return root->value;
 		}
 
-		double info_gain(attr_t attribute, const ExampleList& examples) const {
-			int p = get_positive_count(examples), n = examples.size();
-			return binary_entropy((double)p / (p + n)) - entropy_remain(attribute, examples);
+		/// @brief Classify all rows of data encoded with this tree's schema.
+		std::vector<int> classify(const EncodedDataset& data) const {
+			std::vector<int> result(data.size());
+			for (size_t i = 0; i < data.size(); i++)
+				result[i] = classify(data, i);
+			return result;
 		}
 
-		attr_t importance(const attr_list& attributes, const ExampleList& examples) const {
-			return std::ranges::max(attributes, {}, [&](auto&& s) { return info_gain(s, examples); });
+	private:
+		static size_t node_count(const Node* node) {
+			size_t n = 1;
+			for (auto c : node->children) {
+				if (c) n += node_count(c);
+			}
+			return n;
 		}
 
-		Node* learn(const attr_list& attributes, const ExampleList& examples) const {
-			if (attributes.empty()) {
-				return plurality_value(examples);
-			} else if (have_same_class(examples)) {
-				return new Node(examples[0].raw_label, examples[0].label);
-			} else {
-				attr_t A = importance(attributes, examples); // Most important attribute
-				Node* tree = new Node(A);
-				for (auto&& [v_k, exs] : group_by(examples, A)) {
-					tree->options[v_k] = learn(remove_attribute(attributes, A), exs);
-				}
-				tree->value = plurality_value(examples);
-				return tree;
+		static size_t depth(const Node* node) {
+			size_t d = 0;
+			for (auto c : node->children) {
+				if (c) d = std::max(d, depth(c) + 1);
 			}
+			return d;
 		}
 
-	private:
-		static Node* plurality_value(const ExampleList& examples) {
-			int pos = get_positive_count(examples);
-			int neg = examples.size() - pos;
-			return new Node(examples[0].raw_label, pos >= neg);
+		/// @return Validation errors of the subtree after pruning it.
+		size_t prune(Node* node, const EncodedDataset& data, uint32_t* first, uint32_t* last) {
+			size_t leaf_errors = std::count_if(first, last, [&](auto r) { return data.label(r) != node->value; });
+			if (node->is_leaf())
+				return leaf_errors;
+			// Bucket the rows by child, rows with unknown codes go to a last bucket classified here
+			const Column& column = data.column(node->feature);
+			size_t k = node->children.size();
+			auto branch = [&](uint32_t r) -> size_t {
+				size_t c = column.numeric() ? column.number(r) > node->threshold : column[r];
+				return c < k && node->children[c] ? c : k;
+			};
+			std::vector<size_t> bounds(k + 2, 0);
+			for (auto p = first; p != last; ++p)
+				++bounds[branch(*p) + 1];
+			for (size_t v = 0; v <= k; v++)
+				bounds[v + 1] += bounds[v];
+			std::vector<uint32_t> sorted(last - first);
+			std::vector<size_t> next(bounds.begin(), bounds.end() - 1);
+			for (auto p = first; p != last; ++p)
+				sorted[next[branch(*p)]++] = *p;
+			std::copy(sorted.begin(), sorted.end(), first);
+			size_t subtree_errors = std::count_if(first + bounds[k], last, [&](auto r) { return data.label(r) != node->value; });
+			for (size_t v = 0; v < k; v++) {
+				if (node->children[v])
+					subtree_errors += prune(node->children[v], data, first + bounds[v], first + bounds[v + 1]);
+			}
+			if (leaf_errors > subtree_errors)
+				return subtree_errors;
+			node->feature = -1;
+			node->attribute = _schema.label_name;
+			node->children.clear();
+			return leaf_errors;
 		}
 
+		/// @brief Training state. All rows live in one index array that is partitioned in place by the
+		/// split value at every node, and used attributes are tracked in a mask, so nothing is copied
+		/// during recursion. Each numeric attribute also keeps the rows sorted by its value, presorted
+		/// once and partitioned stably alongside, so the rows of a node occupy the same range in every
+		/// array and the best threshold is found with one linear sweep.
+		///
+		/// With several threads, child subsets of at least min_task_rows rows are spawned as tasks on a
+		/// work-stealing pool and smaller ones recurse serially. Subtrees own disjoint ranges of the
+		/// shared arrays; the used mask, scratch tables and node arena are per worker, and a task starts
+		/// from a copy of its parent's mask. Candidate attributes are drawn from a seed fixed per node,
+		/// so the tree does not depend on scheduling.
+		struct Builder {
+			/// @brief Candidate split. Numeric splits send values <= threshold to the first child.
+			struct Split {
+				int feature = -1;
+				double remain = std::numeric_limits<double>::infinity();	// Remaining entropy times n
+				double threshold = 0;
+			};
+
+			/// @brief State of one worker.
+			struct Context {
+				unsigned worker = 0;
+				std::vector<char> used;	// Categorical attributes already split on along the current path
+				std::vector<uint32_t> counts;	// Scratch count tables
+				std::deque<Node> arena;	// Nodes created by this worker
+			};
+
+			const DecisionTree& tree;
+			const EncodedDataset& data;
+			Options options;
+			std::vector<uint32_t> rows;
+			std::vector<std::vector<uint32_t>> sorted;	// Per numeric attribute, rows ordered by value
+			std::vector<uint32_t> buffer;	// Scratch for stable partitions, indexed like rows
+			std::vector<double> xlogx;	// x * log(x) for every possible count
+			unsigned threads = 1;
+			std::vector<Context> contexts;
+			TaskPool* pool = nullptr;	// Set while building in parallel
+
+			/// Minimum rows * candidate attributes for scoring in parallel
+			static constexpr size_t PARALLEL_WORK = 1 << 20;
+
+			Builder(const DecisionTree& tree, const EncodedDataset& data, Options options):
+				tree(tree), data(data), options(options) {}
+
+			Node* build() {
+				threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+				xlogx.resize(rows.size() + 1);
+				for (size_t i = 1; i <= rows.size(); i++)
+					xlogx[i] = i * std::log((double)i);
+				sorted.assign(data.attribute_count(), {});
+				for (size_t f = 0; f < data.attribute_count(); f++) {
+					if (!data.column(f).numeric()) continue;
+					auto values = data.column(f).numbers();
+					sorted[f] = rows;
+					std::ranges::stable_sort(sorted[f], {}, [&](uint32_t r) { return values[r]; });
+					buffer.resize(rows.size());
+				}
+				contexts.resize(threads);
+				for (unsigned w = 0; w < threads; w++) {
+					contexts[w].worker = w;
+					contexts[w].used.assign(data.attribute_count(), 0);
+				}
+				uint32_t* first = rows.data(), * last = first + rows.size();
+				if (threads == 1 || rows.size() < 2 * options.min_task_rows)
+					return learn(contexts[0], first, last, 0);
+				Node* root = nullptr;
+				TaskPool tasks(threads);
+				pool = &tasks;
+				tasks.run([&](unsigned w) { root = learn(contexts[w], first, last, 0); });
+				pool = nullptr;
+				return root;
+			}
+
+			/// @brief SplitMix64 step.
+			static uint64_t splitmix(uint64_t& state) {
+				uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+				return z ^ (z >> 31);
+			}
+
+			int get_positive_count(const uint32_t* first, const uint32_t* last) const {
+				return std::count_if(first, last, [&](auto r) { return data.label(r); });
+			}
+
+			bool have_same_class(const uint32_t* first, const uint32_t* last) const {
+				return std::all_of(first, last, [&, label = data.label(*first)](auto r) { return data.label(r) == label; });
+			}
+
+			bool plurality(const uint32_t* first, const uint32_t* last) const {
+				int pos = get_positive_count(first, last);
+				int neg = (last - first) - pos;
+				return pos >= neg;
+			}
+
+			/// @brief Build (value x label) count tables for the given features in one pass over the rows.
+			/// Rows are processed in blocks whose indices and labels stay in cache while every feature
+			/// column is gathered. Tables are stored at counts[offsets[i] + code * 2 + label].
+			/// Numeric features are skipped.
+			void count_tables(uint32_t* counts, const int* features, size_t nfeatures, const size_t* offsets, const uint32_t* first, const uint32_t* last) const {
+				constexpr size_t BLOCK = 1024;
+				uint8_t labels[BLOCK];
+				for (auto p = first; p < last; p += BLOCK) {
+					size_t m = std::min<size_t>(BLOCK, last - p);
+					for (size_t i = 0; i < m; i++)
+						labels[i] = data.label(p[i]);
+					for (size_t j = 0; j < nfeatures; j++) {
+						if (data.column(features[j]).numeric()) continue;
+						uint32_t* table = counts + offsets[j];
+						data.column(features[j]).visit([&](auto codes) {
+							for (size_t i = 0; i < m; i++)
+								++table[codes[p[i]] * 2 + labels[i]];
+						});
+					}
+				}
+			}
+
+			/// @brief Remaining entropy times n, in nats, from a count table.
+			double entropy_remain(const uint32_t* table, size_t k) const {
+				double result = 0.0;
+				for (size_t v = 0; v < k; v++) {
+					uint32_t neg = table[v * 2], pos = table[v * 2 + 1];
+					result += xlogx[pos + neg] - xlogx[pos] - xlogx[neg];
+				}
+				return result;
+			}
+
+			/// @brief Whether every non-empty branch of a count table has at least min_leaf_rows rows.
+			bool leaves_large_enough(const uint32_t* table, size_t k) const {
+				for (size_t v = 0; v < k; v++) {
+					size_t m = table[v * 2] + table[v * 2 + 1];
+					if (m && m < options.min_leaf_rows) return false;
+				}
+				return true;
+			}
+
+			/// @brief Find the best threshold of a numeric feature with one sweep over its sorted rows.
+			/// @param positive Number of positive rows in the node.
+			/// @return The split, with infinite remain if every row has the same value.
+			Split sweep(int feature, const uint32_t* first, const uint32_t* last, size_t positive) const {
+				size_t n = last - first;
+				const uint32_t* order = sorted[feature].data() + (first - rows.data());
+				auto values = data.column(feature).numbers();
+				Split best{ feature };
+				size_t left_pos = 0;
+				for (size_t i = 0; i + 1 < n; i++) {
+					left_pos += data.label(order[i]);
+					double x = values[order[i]], y = values[order[i + 1]];
+					if (x == y) continue;
+					size_t left = i + 1, right = n - left, right_pos = positive - left_pos;
+					if (left < options.min_leaf_rows || right < options.min_leaf_rows) continue;
+					double remain = xlogx[left] - xlogx[left_pos] - xlogx[left - left_pos]
+						+ xlogx[right] - xlogx[right_pos] - xlogx[right - right_pos];
+					if (remain < best.remain - 1e-9) {
+						double t = x + (y - x) / 2;
+						best.remain = remain;
+						best.threshold = t < y ? t : x;
+					}
+				}
+				return best;
+			}
+
+			/// @brief Pick the split with the largest information gain among the unused categorical
+			/// attributes and the thresholds of every numeric attribute, or a random subset of them if
+			/// max_features is set. Without the task pool, wide nodes split the candidate attributes
+			/// across threads; under the pool every worker is already busy with its own subtree, so
+			/// nodes are scored serially instead of oversubscribing the cores.
+			Split importance(Context& ctx, const uint32_t* first, const uint32_t* last, size_t depth) const {
+				std::vector<int> features;
+				for (size_t f = 0; f < ctx.used.size(); f++) {
+					if (!ctx.used[f]) features.push_back(f);
+				}
+				if (options.max_features && features.size() > options.max_features) {
+					// Partial Fisher-Yates, then restore attribute order so ties still go to the first.
+					// A node is identified by the start of its range and its depth.
+					uint64_t state = options.seed ^ ((uint64_t)(first - rows.data()) << 16 | depth);
+					for (size_t i = 0; i < options.max_features; i++)
+						std::swap(features[i], features[i + splitmix(state) % (features.size() - i)]);
+					features.resize(options.max_features);
+					std::ranges::sort(features);
+				}
+				std::vector<size_t> offsets;
+				size_t total = 0;
+				for (int f : features) {
+					offsets.push_back(total);
+					if (!data.column(f).numeric())
+						total += data.dictionary(f).size() * 2;
+				}
+				ctx.counts.assign(total, 0);
+				size_t n = last - first, positive = get_positive_count(first, last);
+				std::vector<Split> scores(features.size());
+				auto score = [&](size_t s, size_t m) {
+					count_tables(ctx.counts.data(), features.data() + s, m, offsets.data() + s, first, last);
+					for (size_t j = s; j < s + m; j++) {
+						int f = features[j];
+						if (data.column(f).numeric())
+							scores[j] = sweep(f, first, last, positive);
+						else
+							scores[j] = { f, entropy_remain(ctx.counts.data() + offsets[j], data.dictionary(f).size()) };
+						if (!data.column(f).numeric() && !leaves_large_enough(ctx.counts.data() + offsets[j], data.dictionary(f).size()))
+							scores[j].remain = std::numeric_limits<double>::infinity();
+					}
+				};
+				unsigned nthreads = std::min<size_t>(threads, features.size());
+				if (!pool && nthreads > 1 && n * features.size() >= PARALLEL_WORK) {
+					std::vector<std::thread> workers;
+					size_t per = (features.size() + nthreads - 1) / nthreads;
+					for (size_t s = 0; s < features.size(); s += per)
+						workers.emplace_back(score, s, std::min(per, features.size() - s));
+					for (auto&& t : workers)
+						t.join();
+				} else {
+					score(0, features.size());
+				}
+				Split best;
+				// Maximizing information gain is minimizing the remaining entropy
+				for (auto&& s : scores) {
+					if (s.remain < best.remain - 1e-9)
+						best = s;
+				}
+				return best;
+			}
+
+			/// @brief Reorder rows so that the rows of each branch form a contiguous bucket, keeping the
+			/// presorted orders of numeric attributes sorted within every bucket.
+			/// @param key Branch of a row, less than k.
+			/// @return Bucket boundaries, bucket v is [first + b[v], first + b[v + 1]).
+			template <class Key>
+			std::vector<size_t> partition(size_t k, uint32_t* first, uint32_t* last, Key key) {
+				std::vector<size_t> bounds(k + 1, 0);
+				for (auto p = first; p != last; ++p)
+					++bounds[key(*p) + 1];
+				for (size_t v = 0; v < k; v++)
+					bounds[v + 1] += bounds[v];
+				// American flag sort: swap every row into its bucket
+				std::vector<size_t> next(bounds.begin(), bounds.end() - 1);
+				for (size_t v = 0; v < k; v++) {
+					while (next[v] < bounds[v + 1]) {
+						size_t c = key(first[next[v]]);
+						if (c == v) ++next[v];
+						else std::swap(first[next[v]], first[next[c]++]);
+					}
+				}
+				// Presorted orders need a stable partition
+				size_t offset = first - rows.data(), n = last - first;
+				uint32_t* scratch = buffer.data() + offset;
+				for (auto&& order : sorted) {
+					if (order.empty()) continue;
+					uint32_t* segment = order.data() + offset;
+					next.assign(bounds.begin(), bounds.end() - 1);
+					for (size_t i = 0; i < n; i++)
+						scratch[next[key(segment[i])]++] = segment[i];
+					std::copy_n(scratch, n, segment);
+				}
+				return bounds;
+			}
+
+			/// @brief Information gain of a split, in bits.
+			double gain_bits(const uint32_t* first, const uint32_t* last, const Split& split) const {
+				size_t n = last - first, pos = get_positive_count(first, last);
+				double entropy = xlogx[n] - xlogx[pos] - xlogx[n - pos];
+				return (entropy - split.remain) / (n * std::log(2.0));
+			}
+
+			Node* learn(Context& ctx, uint32_t* first, uint32_t* last, size_t depth) {
+				if (have_same_class(first, last))
+					return &ctx.arena.emplace_back(tree._schema.label_name, data.label(*first));
+				size_t n = last - first;
+				if ((options.max_depth && depth >= options.max_depth) || n < 2 * options.min_leaf_rows)
+					return &ctx.arena.emplace_back(tree._schema.label_name, plurality(first, last));
+				Split split = importance(ctx, first, last, depth); // Most important attribute
+				if (split.feature < 0 || (options.min_gain > 0 && gain_bits(first, last, split) < options.min_gain))
+					return &ctx.arena.emplace_back(tree._schema.label_name, plurality(first, last));
+				int A = split.feature;
+				Node* node = &ctx.arena.emplace_back(tree._schema.attributes[A]);
+				node->feature = A;
+				node->value = plurality(first, last);
+				node->threshold = split.threshold;
+				const Column& column = data.column(A);
+				std::vector<size_t> bounds;
+				if (column.numeric()) {
+					auto values = column.numbers();
+					bounds = partition(2, first, last, [&](uint32_t r) { return values[r] > split.threshold; });
+				} else {
+					column.visit([&](auto codes) {
+						bounds = partition(data.dictionary(A).size(), first, last, [&](uint32_t r) { return codes[r]; });
+					});
+					ctx.used[A] = 1;
+				}
+				node->children.resize(bounds.size() - 1, nullptr);
+				for (size_t v_k = 0; v_k + 1 < bounds.size(); v_k++) {
+					uint32_t* f = first + bounds[v_k], * l = first + bounds[v_k + 1];
+					if (f == l) continue;
+					if (pool && size_t(l - f) >= options.min_task_rows) {
+						pool->spawn(ctx.worker, [this, node, v_k, f, l, depth, used = ctx.used](unsigned w) {
+							Context& c = contexts[w];
+							c.used = used;
+							node->children[v_k] = learn(c, f, l, depth + 1);
+						});
+					} else {
+						node->children[v_k] = learn(ctx, f, l, depth + 1);
+					}
+				}
+				ctx.used[A] = 0;
+				return node;
+			}
+		};
+
 	private:
+		Schema _schema;
 		Node* _root;
+		std::vector<std::deque<Node>> _arenas;	// Node storage, one per training thread
 	};
 
 
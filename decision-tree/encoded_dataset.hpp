@@ -0,0 +1,286 @@
+#pragma once
+#include "dataset.hpp"
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+namespace qy::ai {
+
+	using code_t = uint16_t;
+
+	/// @brief Parse a numeric attribute value.
+	/// @return Whether the whole value is a number.
+	inline bool parse_number(std::string_view value, double& result) {
+		auto r = std::from_chars(value.data(), value.data() + value.size(), result);
+		return r.ec == std::errc() && r.ptr == value.data() + value.size();
+	}
+
+	/// @brief Maps the distinct values of one attribute to consecutive codes.
+	/// The largest code_t is kept free, so size() and the "absent" code returned by find() never
+	/// wrap to a valid code.
+	class Dictionary {
+		struct string_hash {
+			using is_transparent = void;
+			size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+		};
+
+	public:
+		static constexpr size_t MAX_SIZE = std::numeric_limits<code_t>::max();
+
+		/// @brief Get the code of a value, adding it if absent.
+		code_t encode(std::string_view value) {
+			if (auto it = _index.find(value); it != _index.end())
+				return it->second;
+			if (_values.size() >= MAX_SIZE)
+				throw std::runtime_error("Too many distinct values");
+			code_t code = _values.size();
+			_values.emplace_back(value);
+			_index.emplace(_values.back(), code);
+			return code;
+		}
+
+		/// @return The code of a value, or size() if absent.
+		code_t find(std::string_view value) const {
+			auto it = _index.find(value);
+			return it != _index.end() ? it->second : size();
+		}
+
+		const std::string& decode(code_t code) const { return _values[code]; }
+		code_t size() const { return _values.size(); }
+
+	private:
+		std::vector<std::string> _values;
+		std::unordered_map<std::string, code_t, string_hash, std::equal_to<>> _index;
+	};
+
+	/// @brief Column of codes, stored as uint8_t until a code no longer fits.
+	/// Numeric columns store the values themselves instead of codes.
+	class Column {
+	public:
+		explicit Column(bool numeric = false): _numeric(numeric) {}
+
+		void push_back(code_t code) {
+			if (!_wide && code > std::numeric_limits<uint8_t>::max()) {
+				_wide = true;
+				_codes16.assign(_codes8.begin(), _codes8.end());
+				_codes8 = {};
+			}
+			if (_wide) _codes16.push_back(code);
+			else _codes8.push_back(code);
+		}
+
+		/// @brief Replace the contents, picking the width from the largest code.
+		void assign(std::span<const code_t> codes) {
+			_wide = !codes.empty() && std::ranges::max(codes) > std::numeric_limits<uint8_t>::max();
+			_codes8.clear();
+			_codes16.clear();
+			if (_wide) _codes16.assign(codes.begin(), codes.end());
+			else _codes8.assign(codes.begin(), codes.end());
+		}
+
+		void push_number(double value) {
+			_numbers.push_back(value);
+		}
+
+		void assign_numbers(std::vector<double> numbers) {
+			_numbers = std::move(numbers);
+		}
+
+		void resize(size_t n) {
+			if (_numeric) _numbers.resize(n);
+			else if (_wide) _codes16.resize(n);
+			else _codes8.resize(n);
+		}
+
+		void set(size_t i, code_t code) {
+			if (_wide) _codes16[i] = code;
+			else _codes8[i] = code;
+		}
+
+		code_t operator[] (size_t i) const {
+			return _wide ? _codes16[i] : _codes8[i];
+		}
+
+		size_t size() const { return _numeric ? _numbers.size() : _wide ? _codes16.size() : _codes8.size(); }
+		bool wide() const { return _wide; }
+		bool numeric() const { return _numeric; }
+
+		double number(size_t i) const { return _numbers[i]; }
+		std::span<const double> numbers() const { return _numbers; }
+
+		/// @brief Call fn with the codes as a contiguous span of their stored type. Not for numeric columns.
+		template <class Fn>
+		decltype(auto) visit(Fn&& fn) const {
+			if (_wide) return fn(std::span<const uint16_t>(_codes16));
+			return fn(std::span<const uint8_t>(_codes8));
+		}
+
+	private:
+		bool _numeric = false;
+		bool _wide = false;
+		std::vector<uint8_t> _codes8;
+		std::vector<uint16_t> _codes16;
+		std::vector<double> _numbers;
+	};
+
+	class BitVector {
+	public:
+		using word_t = uint64_t;
+
+		void push_back(bool value) {
+			if (_size % 64 == 0) _words.push_back(0);
+			set(_size++, value);
+		}
+
+		void resize(size_t n) {
+			_words.resize((n + 63) / 64);
+			_size = n;
+		}
+
+		void set(size_t i, bool value) {
+			word_t m = (word_t)1 << (i % 64);
+			if (value) _words[i / 64] |= m;
+			else _words[i / 64] &= ~m;
+		}
+
+		bool operator[] (size_t i) const {
+			return _words[i / 64] >> (i % 64) & 1;
+		}
+
+		size_t count() const {
+			size_t s = 0;
+			for (auto w : _words) s += std::popcount(w);
+			return s;
+		}
+
+		size_t size() const { return _size; }
+		const std::vector<word_t>& words() const { return _words; }
+
+	private:
+		std::vector<word_t> _words;
+		size_t _size = 0;
+	};
+
+	/// @brief Attribute names and value dictionaries, shared by data encoded for the same model.
+	struct Schema {
+		attr_list attributes;
+		attr_t label_name;
+		std::vector<Dictionary> dictionaries;	// Empty for numeric attributes
+		std::vector<char> numeric;	// Per attribute, split by threshold instead of by value
+
+		/// @brief Mark attributes as numeric by name.
+		void set_numeric(std::span<const attr_t> names) {
+			numeric.resize(attributes.size());
+			for (auto&& name : names) {
+				int j = attribute_index(name);
+				if (j < 0)
+					throw std::runtime_error("Unknown attribute: " + name);
+				numeric[j] = 1;
+			}
+		}
+
+		bool is_numeric(size_t attribute) const {
+			return attribute < numeric.size() && numeric[attribute];
+		}
+
+		/// @return Index of the attribute, or -1 if absent.
+		int attribute_index(const attr_t& attribute) const {
+			auto it = std::ranges::find(attributes, attribute);
+			return it != attributes.end() ? it - attributes.begin() : -1;
+		}
+	};
+
+	/// @brief Columnar dataset with dictionary-encoded values and labels in a bit-vector.
+	class EncodedDataset {
+	public:
+		EncodedDataset() = default;
+
+		/// @brief Create an empty dataset.
+		/// @param schema Schema to encode with. Values not in its dictionaries get new codes.
+		explicit EncodedDataset(Schema schema, bool labeled): _schema(std::move(schema)), _labeled(labeled) {
+			init_columns();
+		}
+
+		/// @brief Encode a dataset.
+		/// @param base Schema of a previously encoded dataset to stay compatible with, or null.
+		explicit EncodedDataset(const Dataset& dataset, const Schema* base = nullptr) {
+			if (base) {
+				_schema = *base;
+			} else {
+				_schema.attributes = dataset.attributes;
+				_schema.label_name = dataset._labeled && !dataset.examples.empty() ? dataset.examples[0].raw_label : attr_t{};
+			}
+			_labeled = dataset._labeled;
+			init_columns();
+			std::vector<std::string_view> row(_schema.attributes.size());
+			for (auto&& e : dataset.examples) {
+				for (size_t j = 0; j < row.size(); j++)
+					row[j] = e.data.at(_schema.attributes[j]);
+				add_row(row, e.label);
+			}
+		}
+
+		/// @brief Append a row of raw values in attribute order.
+		void add_row(std::span<const std::string_view> values, bool label) {
+			for (size_t j = 0; j < _columns.size(); j++) {
+				if (_columns[j].numeric()) {
+					double x;
+					if (!parse_number(values[j], x))
+						throw std::runtime_error("Not a number: " + std::string(values[j]));
+					_columns[j].push_number(x);
+				} else {
+					_columns[j].push_back(_schema.dictionaries[j].encode(values[j]));
+				}
+			}
+			_labels.push_back(label);
+			++_rows;
+		}
+
+		/// @brief Encode an example against this dataset's dictionaries without modifying them.
+		/// Unknown values get the code equal to the dictionary size, numeric attributes always do.
+		std::vector<code_t> encode(const Example& example) const {
+			std::vector<code_t> codes(_columns.size());
+			for (size_t j = 0; j < codes.size(); j++)
+				codes[j] = _schema.dictionaries[j].find(example.data.at(_schema.attributes[j]));
+			return codes;
+		}
+
+		const Schema& schema() const { return _schema; }
+		const attr_list& attributes() const { return _schema.attributes; }
+		const Dictionary& dictionary(size_t attribute) const { return _schema.dictionaries[attribute]; }
+		const Column& column(size_t attribute) const { return _columns[attribute]; }
+		const BitVector& labels() const { return _labels; }
+		bool label(size_t row) const { return _labels[row]; }
+		size_t size() const { return _rows; }
+		size_t attribute_count() const { return _columns.size(); }
+		bool labeled() const { return _labeled; }
+
+		std::vector<int> get_labels() const {
+			std::vector<int> result(_rows);
+			for (size_t i = 0; i < _rows; i++) result[i] = _labels[i];
+			return result;
+		}
+
+	protected:
+		friend class CsvLoader;
+
+		void init_columns() {
+			size_t n = _schema.attributes.size();
+			_schema.dictionaries.resize(n);
+			_schema.numeric.resize(n);
+			_columns.clear();
+			for (size_t j = 0; j < n; j++)
+				_columns.emplace_back(_schema.is_numeric(j));
+		}
+
+		Schema _schema;
+		std::vector<Column> _columns;
+		BitVector _labels;
+		size_t _rows = 0;
+		bool _labeled = false;
+	};
+
+} // namespace qy::ai
@@ -0,0 +1,146 @@
+#pragma once
+#include "compiled_tree.hpp"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <ostream>
+
+namespace qy::ai {
+
+	/// @brief Evaluation over the train/test splits data/train{i}.csv and data/test{i}.csv.
+	/// All splits are loaded and encoded once, in parallel, when the evaluator is created; every
+	/// run() then trains and scores the folds in parallel, one fold per task.
+	class FoldEvaluator {
+	public:
+		struct Config {
+			fs::path directory = "data";
+			int folds = 10;
+			unsigned threads = 0;	// 0 for all cores
+			double min_score_ms = 20;	// Score each test set repeatedly for at least this long
+			CsvLoader::Options load_options = {};
+		};
+
+		struct Stats {
+			int fold;
+			size_t train_rows, test_rows;
+			double accuracy, precision, recall;	// Precision and recall of the positive class
+			double train_ms;
+			double rows_per_second;	// Batch inference throughput
+			size_t nodes;
+			size_t model_bytes;	// Size of the saved model
+		};
+
+		explicit FoldEvaluator(Config config): _config(std::move(config)), _folds(_config.folds) {
+			for_each_fold([&](int i) {
+				CsvLoader loader(_config.load_options);
+				auto& f = _folds[i];
+				f.train.emplace(loader.load(_config.directory / ("train" + std::to_string(i) + ".csv")));
+				f.test.emplace(loader.load(_config.directory / ("test" + std::to_string(i) + ".csv"), &f.train->schema()));
+			});
+		}
+
+		/// @param options Training options. Folds already run in parallel, so threads defaults to 1.
+		std::vector<Stats> run(DecisionTree::Options options = { .threads = 1 }) const {
+			std::vector<Stats> result(_folds.size());
+			for_each_fold([&](int i) {
+				using clock = std::chrono::steady_clock;
+				const EncodedDataset& train = *_folds[i].train, & test = *_folds[i].test;
+				Stats& s = result[i];
+				s.fold = i;
+				s.train_rows = train.size();
+				s.test_rows = test.size();
+
+				auto st = clock::now();
+				DecisionTree tree(train, options);
+				CompiledTree model(tree);
+				s.train_ms = std::chrono::duration<double, std::milli>(clock::now() - st).count();
+				s.nodes = model.nodes().size();
+				s.model_bytes = model.byte_size();
+
+				model.set_threads(1);
+				std::vector<int> pred;
+				size_t scored = 0;
+				st = clock::now();
+				double elapsed;
+				do {
+					pred = model.classify(test);
+					scored += test.size();
+					elapsed = std::chrono::duration<double>(clock::now() - st).count();
+				} while (elapsed * 1000 < _config.min_score_ms);
+				s.rows_per_second = elapsed > 0 ? scored / elapsed : 0;
+
+				size_t tp = 0, fp = 0, fn = 0, correct = 0;
+				for (size_t r = 0; r < test.size(); r++) {
+					bool p = pred[r], g = test.label(r);
+					correct += p == g;
+					tp += p && g;
+					fp += p && !g;
+					fn += !p && g;
+				}
+				s.accuracy = test.size() ? (double)correct / test.size() : 0;
+				s.precision = tp + fp ? (double)tp / (tp + fp) : 0;
+				s.recall = tp + fn ? (double)tp / (tp + fn) : 0;
+			});
+			return result;
+		}
+
+		void write_json(std::ostream& os, const std::vector<Stats>& stats) const {
+			double accuracy = 0, precision = 0, recall = 0, train_ms = 0, rows_per_second = 0;
+			os << "{\"folds\":[";
+			for (size_t i = 0; i < stats.size(); i++) {
+				auto& s = stats[i];
+				os << (i ? "," : "") << "{\"fold\":" << s.fold << ",\"train_rows\":" << s.train_rows
+					<< ",\"test_rows\":" << s.test_rows << ",\"accuracy\":" << s.accuracy
+					<< ",\"precision\":" << s.precision << ",\"recall\":" << s.recall
+					<< ",\"train_ms\":" << s.train_ms << ",\"rows_per_second\":" << s.rows_per_second
+					<< ",\"nodes\":" << s.nodes << ",\"model_bytes\":" << s.model_bytes << "}";
+				accuracy += s.accuracy;
+				precision += s.precision;
+				recall += s.recall;
+				train_ms += s.train_ms;
+				rows_per_second += s.rows_per_second;
+			}
+			double n = std::max<size_t>(1, stats.size());
+			os << "],\"mean\":{\"accuracy\":" << accuracy / n << ",\"precision\":" << precision / n
+				<< ",\"recall\":" << recall / n << ",\"train_ms\":" << train_ms / n
+				<< ",\"rows_per_second\":" << rows_per_second / n << "}}\n";
+		}
+
+	private:
+		struct Fold {
+			std::optional<EncodedDataset> train, test;
+		};
+
+		/// @brief Call fn(i) for every fold, spread across threads.
+		template <class Fn>
+		void for_each_fold(Fn fn) const {
+			std::atomic<int> next{ 0 };
+			std::vector<std::exception_ptr> errors(_folds.size());
+			auto worker = [&]() {
+				for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < (int)_folds.size(); ) {
+					try {
+						fn(i);
+					} catch (...) {
+						errors[i] = std::current_exception();
+					}
+				}
+			};
+			unsigned nthreads = _config.threads ? _config.threads : std::max(1u, std::thread::hardware_concurrency());
+			nthreads = std::min<size_t>(nthreads, _folds.size());
+			std::vector<std::thread> threads;
+			for (unsigned t = 1; t < nthreads; t++)
+				threads.emplace_back(worker);
+			worker();
+			for (auto&& t : threads)
+				t.join();
+			for (auto&& e : errors) {
+				if (e) std::rethrow_exception(e);
+			}
+		}
+
+		Config _config;
+		std::vector<Fold> _folds;
+	};
+
+} // namespace qy::ai
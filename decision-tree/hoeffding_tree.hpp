@@ -0,0 +1,291 @@
+#pragma once
+#include "encoded_dataset.hpp"
+#include <cmath>
+#include <span>
+
+namespace qy::ai {
+
+	/// @brief Streaming decision tree learner (Hoeffding tree / VFDT) over categorical attributes.
+	/// Examples are consumed one at a time or in mini-batches and never stored. Every active leaf keeps
+	/// (value x label) counts of the attributes not yet used on its path; after each grace period a
+	/// leaf splits on its best attribute once the Hoeffding bound shows, with probability 1 - delta,
+	/// that it beats the runner-up, or once the two are too close to matter. When more than
+	/// max_active_leaves leaves hold counts, the least promising ones (fewest misclassified examples)
+	/// drop theirs and only predict, which bounds memory. The tree can classify at any time.
+	class HoeffdingTree {
+	public:
+		static constexpr uint32_t NONE = UINT32_MAX;
+
+		struct Options {
+			double delta = 1e-7;	// Allowed probability of choosing a worse split
+			double tie_threshold = 0.05;	// Split anyway once the bound is below this, in bits
+			size_t grace_period = 200;	// Examples a leaf sees between split attempts
+			size_t max_active_leaves = 1 << 12;
+		};
+
+		/// @param schema Attribute names and label name. Dictionaries may be empty; they grow as new
+		/// values arrive. Numeric attributes are not supported.
+		explicit HoeffdingTree(Schema schema): HoeffdingTree(std::move(schema), Options{}) {}
+
+		HoeffdingTree(Schema schema, Options options): _schema(std::move(schema)), _options(options) {
+			_schema.dictionaries.resize(_schema.attributes.size());
+			for (size_t j = 0; j < _schema.attributes.size(); j++) {
+				if (_schema.is_numeric(j))
+					throw std::invalid_argument("Numeric attribute not supported: " + _schema.attributes[j]);
+			}
+			_nodes.emplace_back();
+			activate(0, std::vector<char>(_schema.attributes.size(), 0));
+		}
+
+		/// @brief Learn from one example given as raw values in attribute order.
+		void learn(std::span<const std::string_view> values, bool label) {
+			_codes.resize(values.size());
+			for (size_t j = 0; j < values.size(); j++)
+				_codes[j] = _schema.dictionaries[j].encode(values[j]);
+			learn_codes(_codes.data(), label);
+		}
+
+		void learn(const Example& example) {
+			std::vector<std::string_view> values(_schema.attributes.size());
+			for (size_t j = 0; j < values.size(); j++)
+				values[j] = example.data.at(_schema.attributes[j]);
+			learn(values, example.label);
+		}
+
+		/// @brief Learn from a mini-batch. The batch may use its own dictionaries; its codes are
+		/// translated once per distinct value.
+		void learn(const EncodedDataset& batch) {
+			size_t nattr = _schema.attributes.size();
+			std::vector<std::vector<code_t>> remap(nattr);
+			std::vector<const Column*> columns(nattr);
+			for (size_t j = 0; j < nattr; j++) {
+				int b = batch.schema().attribute_index(_schema.attributes[j]);
+				if (b < 0 || batch.column(b).numeric())
+					throw std::invalid_argument("Batch lacks categorical attribute: " + _schema.attributes[j]);
+				columns[j] = &batch.column(b);
+				const Dictionary& dict = batch.dictionary(b);
+				for (code_t v = 0; v < dict.size(); v++)
+					remap[j].push_back(_schema.dictionaries[j].encode(dict.decode(v)));
+			}
+			_codes.resize(nattr);
+			for (size_t r = 0; r < batch.size(); r++) {
+				for (size_t j = 0; j < nattr; j++)
+					_codes[j] = remap[j][(*columns[j])[r]];
+				learn_codes(_codes.data(), batch.label(r));
+			}
+		}
+
+		/// @brief Classify raw values given in attribute order.
+		bool classify(std::span<const std::string_view> values) const {
+			return classify_by([&](int j) { return _schema.dictionaries[j].find(values[j]); });
+		}
+
+		bool classify(const Example& example) const {
+			return classify_by([&](int j) { return _schema.dictionaries[j].find(example.data.at(_schema.attributes[j])); });
+		}
+
+		/// @brief Classify every row of a dataset with the same attribute names. The dataset may use
+		/// its own dictionaries; its codes are translated once per distinct value, and attributes it
+		/// lacks or stores as numbers count as unseen values.
+		std::vector<int> classify(const EncodedDataset& data) const {
+			size_t nattr = _schema.attributes.size();
+			std::vector<std::vector<code_t>> remap(nattr);
+			std::vector<const Column*> columns(nattr, nullptr);
+			for (size_t j = 0; j < nattr; j++) {
+				int b = data.schema().attribute_index(_schema.attributes[j]);
+				if (b < 0 || data.column(b).numeric()) continue;
+				columns[j] = &data.column(b);
+				const Dictionary& dict = data.dictionary(b);
+				for (code_t v = 0; v < dict.size(); v++)
+					remap[j].push_back(_schema.dictionaries[j].find(dict.decode(v)));
+			}
+			std::vector<int> result(data.size());
+			for (size_t r = 0; r < data.size(); r++) {
+				result[r] = classify_by([&](int j) -> code_t {
+					return columns[j] ? remap[j][(*columns[j])[r]] : _schema.dictionaries[j].size();
+				});
+			}
+			return result;
+		}
+
+		const Schema& schema() const { return _schema; }
+		size_t node_count() const { return _nodes.size(); }
+		size_t active_leaves() const { return _active; }
+		uint64_t examples_seen() const { return _nodes[0].counts[0] + _nodes[0].counts[1]; }
+
+	private:
+		struct Node {
+			int feature = -1;	// Split attribute, -1 for leaves
+			uint32_t parent = NONE;
+			uint32_t stats = NONE;	// Index of the counts of an active leaf
+			bool value = true;	// Plurality of the examples that reached this node
+			uint64_t counts[2] = {};	// Examples that reached this node, by label
+			std::vector<uint32_t> children;	// By code, NONE until a value arrives
+		};
+
+		struct LeafStats {
+			std::vector<char> used;	// Attributes split on along the path
+			std::vector<std::vector<uint64_t>> counts;	// [attribute][code * 2 + label]
+			uint64_t checked = 0;	// Examples seen at the last split attempt
+		};
+
+		template <class CodeOf>
+		bool classify_by(CodeOf code_of) const {
+			const Node* node = &_nodes[0];
+			while (node->feature >= 0) {
+				size_t c = code_of(node->feature);
+				if (c >= node->children.size() || node->children[c] == NONE)
+					return node->value;
+				node = &_nodes[node->children[c]];
+			}
+			return node->value;
+		}
+
+		void learn_codes(const code_t* codes, bool label) {
+			uint32_t id = 0;
+			while (true) {
+				Node& node = _nodes[id];
+				++node.counts[label];
+				node.value = node.counts[1] >= node.counts[0];
+				if (node.feature < 0) break;
+				code_t c = codes[node.feature];
+				if (c >= node.children.size())
+					node.children.resize(c + 1, NONE);
+				if (node.children[c] == NONE) {
+					uint32_t child = add_leaf(id);
+					_nodes[id].children[c] = child;
+				}
+				id = _nodes[id].children[c];
+			}
+			Node& leaf = _nodes[id];
+			if (leaf.stats == NONE) return;
+			LeafStats& st = _stats[leaf.stats];
+			for (size_t j = 0; j < st.counts.size(); j++) {
+				if (st.used[j]) continue;
+				auto& table = st.counts[j];
+				if (codes[j] * 2u + 1 >= table.size())
+					table.resize(codes[j] * 2 + 2, 0);
+				++table[codes[j] * 2 + label];
+			}
+			uint64_t n = leaf.counts[0] + leaf.counts[1];
+			if (n - st.checked >= _options.grace_period) {
+				st.checked = n;
+				try_split(id);
+			}
+		}
+
+		uint32_t add_leaf(uint32_t parent) {
+			uint32_t id = _nodes.size();
+			Node& node = _nodes.emplace_back();
+			node.parent = parent;
+			// Rebuild the used mask from the path
+			std::vector<char> used(_schema.attributes.size(), 0);
+			for (uint32_t p = parent; p != NONE; p = _nodes[p].parent)
+				used[_nodes[p].feature] = 1;
+			activate(id, std::move(used));
+			return id;
+		}
+
+		void activate(uint32_t id, std::vector<char> used) {
+			uint32_t s;
+			if (!_free.empty()) {
+				s = _free.back();
+				_free.pop_back();
+			} else {
+				s = _stats.size();
+				_stats.emplace_back();
+			}
+			LeafStats& st = _stats[s];
+			st.used = std::move(used);
+			st.counts.assign(_schema.attributes.size(), {});
+			st.checked = 0;
+			_nodes[id].stats = s;
+			++_active;
+			if (_active > _options.max_active_leaves)
+				deactivate_least_promising();
+		}
+
+		void deactivate(uint32_t id) {
+			uint32_t s = _nodes[id].stats;
+			_stats[s] = {};
+			_free.push_back(s);
+			_nodes[id].stats = NONE;
+			--_active;
+		}
+
+		/// @brief Drop the counts of the active leaves that misclassified the fewest examples,
+		/// down to half the limit so this does not run on every new leaf.
+		void deactivate_least_promising() {
+			std::vector<uint32_t> leaves;
+			for (uint32_t i = 0; i < _nodes.size(); i++) {
+				if (_nodes[i].stats != NONE) leaves.push_back(i);
+			}
+			size_t drop = leaves.size() - std::max<size_t>(1, _options.max_active_leaves / 2);
+			auto errors = [&](uint32_t i) { return std::min(_nodes[i].counts[0], _nodes[i].counts[1]); };
+			std::ranges::nth_element(leaves, leaves.begin() + drop, {}, errors);
+			for (size_t i = 0; i < drop; i++)
+				deactivate(leaves[i]);
+		}
+
+		static double xlogx(double x) {
+			return x > 0 ? x * std::log2(x) : 0;
+		}
+
+		void try_split(uint32_t id) {
+			Node& leaf = _nodes[id];
+			double n = leaf.counts[0] + leaf.counts[1];
+			if (leaf.counts[0] == 0 || leaf.counts[1] == 0) return;
+			const LeafStats& st = _stats[leaf.stats];
+			double entropy = xlogx(n) - xlogx(leaf.counts[0]) - xlogx(leaf.counts[1]);
+			int best = -1;
+			double best_gain = 0, second_gain = 0;
+			for (size_t j = 0; j < st.counts.size(); j++) {
+				if (st.used[j]) continue;
+				auto& table = st.counts[j];
+				double remain = 0;
+				for (size_t v = 0; v + 1 < table.size(); v += 2)
+					remain += xlogx(table[v] + table[v + 1]) - xlogx(table[v]) - xlogx(table[v + 1]);
+				double gain = (entropy - remain) / n;
+				if (best == -1 || gain > best_gain) {
+					second_gain = best_gain;
+					best_gain = gain;
+					best = j;
+				} else if (gain > second_gain) {
+					second_gain = gain;
+				}
+			}
+			if (best < 0 || best_gain <= 0) return;
+			// Labels are binary, so information gain ranges over one bit
+			double epsilon = std::sqrt(std::log(1 / _options.delta) / (2 * n));
+			if (best_gain - second_gain <= epsilon && epsilon >= _options.tie_threshold) return;
+
+			std::vector<char> used = st.used;
+			std::vector<uint64_t> table = st.counts[best];
+			used[best] = 1;
+			deactivate(id);
+			_nodes[id].feature = best;
+			_nodes[id].children.assign(table.size() / 2, NONE);
+			for (size_t v = 0; v < table.size() / 2; v++) {
+				uint64_t neg = table[v * 2], pos = table[v * 2 + 1];
+				if (neg + pos == 0) continue;
+				uint32_t child = _nodes.size();
+				Node& node = _nodes.emplace_back();
+				node.parent = id;
+				node.counts[0] = neg;
+				node.counts[1] = pos;
+				node.value = pos >= neg;
+				_nodes[id].children[v] = child;
+				activate(child, used);
+			}
+		}
+
+		Schema _schema;
+		Options _options;
+		std::vector<Node> _nodes;
+		std::vector<LeafStats> _stats;
+		std::vector<uint32_t> _free;	// Unused entries of _stats
+		size_t _active = 0;
+		std::vector<code_t> _codes;	// Scratch for encoding one example
+	};
+
+} // namespace qy::ai
@@ -1,18 +1,108 @@
 #include "decision_tree.hpp"
+#include "compiled_tree.hpp"
+#include "codegen.hpp"
 #include "utils.hpp"
+#include "csv_loader.hpp"
+#include "evaluation.hpp"
+#include "hoeffding_tree.hpp"
+#include <fstream>
+#ifdef GENERATED_TREE
+#include GENERATED_TREE
+#endif
+
+/// @brief Train and score every train/test split, printing the results as JSON.
+void evaluate_folds() {
+	using namespace qy::ai;
+	FoldEvaluator evaluator({ .directory = "data" });
+	evaluator.write_json(std::cout, evaluator.run());
+}
+
+/// @brief Train with a quarter of train0 held out, prune against it and compare on test5.
+void prune_display() {
+	using namespace qy::ai;
+	CsvLoader loader;
+	auto data = loader.load("data/train0.csv");
+	auto test_data = loader.load("data/test5.csv", &data.schema());
+	std::vector<uint32_t> train_rows, validation_rows;
+	for (uint32_t r = 0; r < data.size(); r++)
+		(r % 4 == 3 ? validation_rows : train_rows).push_back(r);
+	DecisionTree dt(data, DecisionTree::Options{ .min_leaf_rows = 2 }, train_rows);
+	double before = evaluate(CompiledTree(dt).classify(test_data), test_data.get_labels());
+	auto stats = dt.prune(data, validation_rows);
+	double after = evaluate(CompiledTree(dt).classify(test_data), test_data.get_labels());
+	std::cout << "Nodes: " << stats.nodes_before << " -> " << stats.nodes_after
+		<< ", depth: " << stats.depth_before << " -> " << stats.depth_after
+		<< ", precision: " << before << " -> " << after << std::endl;
+}
+
+/// @brief Feed the training splits to a streaming learner one by one, scoring test5 after each.
+void stream_display() {
+	using namespace qy::ai;
+	CsvLoader loader;
+	auto test_data = loader.load("data/test5.csv");
+	HoeffdingTree ht(test_data.schema(), HoeffdingTree::Options{ .grace_period = 50 });
+	for (int i = 0; i < 10; i++) {
+		ht.learn(loader.load("data/train" + std::to_string(i) + ".csv"));
+		std::cout << "Seen: " << ht.examples_seen() << ", nodes: " << ht.node_count()
+			<< ", precision: " << evaluate(ht.classify(test_data), test_data.get_labels()) << std::endl;
+	}
+}
+
+/// @brief Emit the tree trained on train0 as a C++ header.
+/// Building again with -DGENERATED_TREE='"<header>"' compiles the emitted header into this program,
+/// and its classifications of test5 are then checked against CompiledTree::classify.
+void codegen_display() {
+	using namespace qy::ai;
+	CsvLoader loader;
+	auto train_data = loader.load("data/train0.csv");
+	CompiledTree tree{ DecisionTree(train_data) };
+	fs::path header = fs::temp_directory_path() / "decision_tree_train0.hpp";
+	{
+		std::ofstream out(header);
+		write_cpp(out, tree, { .namespace_name = "train0" });
+	}
+	std::cout << "Generated: " << header.string() << std::endl;
+#ifdef GENERATED_TREE
+	auto test_data = loader.load("data/test5.csv", &tree.schema());
+	auto expected = tree.classify(test_data);
+	std::vector<double> row(test_data.attribute_count());
+	size_t mismatches = 0;
+	for (size_t r = 0; r < test_data.size(); r++) {
+		for (size_t j = 0; j < row.size(); j++) {
+			const Column& column = test_data.column(j);
+			row[j] = tree.schema().is_numeric(j) ? column.number(r) : column[r];
+		}
+		mismatches += train0::classify(row) != (bool)expected[r];
+	}
+	std::cout << "Generated tree mismatches: " << mismatches << std::endl;
+#endif
+}
 
 int main() {
 
 	using namespace qy::ai;
 	fs::current_path(fs::absolute(__FILE__).parent_path());
-	Dataset train_ds("data/train0.csv", true);
-	Dataset test_ds("data/test5.csv", true);
+	CsvLoader loader;
+	// Numeric attributes are split by threshold instead of by value:
+	// CsvLoader loader(CsvLoader::Options{ .numeric = { "PATRONS", "PRICE", "WAITESTIMATE" } });
 
-	DecisionTree dt(train_ds);
-	// print_tree(dt);
-	auto ans = dt.classify(test_ds.examples);
-	auto gt = get_labels(test_ds.examples);
+	// Train, save the compiled model and classify with the mapped file
+	fs::path model_path = fs::temp_directory_path() / "decision-tree-train0.model";
+	{
+		auto train_data = loader.load("data/train0.csv");
+		DecisionTree dt(train_data);
+		// print_tree(dt);
+		CompiledTree(dt).save(model_path);
+	}
+	auto model = CompiledTree::load(model_path);
+	auto test_data = loader.load("data/test5.csv", &model.schema());
+	auto ans = model.classify(test_data);
+	auto gt = test_data.get_labels();
 	std::cout << "Precision: " << evaluate(ans, gt) << std::endl;
-	// print_examples(train_ds.examples);
+
+	evaluate_folds();
+	// prune_display();
+	// stream_display();
+	// codegen_display();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+#include "compiled_tree.hpp"
+#include <atomic>
+#include <cmath>
+#include <optional>
+#include <random>
+
+namespace qy::ai {
+
+	/// @brief Bagged ensemble of decision trees.
+	/// Every tree trains on its own bootstrap sample of row indices into one shared, read-only
+	/// EncodedDataset, drawing a random subset of candidate attributes at each node. Trees are built
+	/// concurrently by workers taking tree indices from a shared counter, and each tree's seed is
+	/// derived from (seed, index), so the forest does not depend on the number of threads. The
+	/// compiled trees share one copy of the schema and its dictionaries.
+	class RandomForest {
+	public:
+		struct Options {
+			size_t trees = 100;
+			size_t max_features = 0;	// Candidate attributes per node, 0 for sqrt of the attribute count
+			double sample_ratio = 1.0;	// Bootstrap sample size relative to the dataset
+			uint64_t seed = 114514u;
+			unsigned threads = 0;	// 0 for all cores
+		};
+
+		RandomForest(const EncodedDataset& data): RandomForest(data, Options{}) {}
+
+		RandomForest(const EncodedDataset& data, Options options):
+			_schema(std::make_shared<const Schema>(data.schema())), _threads(options.threads) {
+			if (options.trees == 0 || options.trees > std::numeric_limits<uint16_t>::max())
+				throw std::invalid_argument("Tree count must be in [1, 65535]");
+			size_t features = options.max_features ? options.max_features
+				: std::max<size_t>(1, std::lround(std::sqrt((double)data.attribute_count())));
+			size_t samples = std::max<size_t>(1, std::llround(data.size() * options.sample_ratio));
+			std::vector<std::optional<CompiledTree>> trees(options.trees);
+			std::atomic<size_t> next{ 0 };
+			auto worker = [&]() {
+				std::vector<uint32_t> rows(samples);
+				for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < trees.size(); ) {
+					uint64_t seed = tree_seed(options.seed, i);
+					std::mt19937_64 rng(seed);
+					std::uniform_int_distribution<uint32_t> pick(0, data.size() - 1);
+					for (auto& r : rows)
+						r = pick(rng);
+					// Trees already run in parallel, so each scores its nodes serially
+					DecisionTree tree(data, { features, seed, 1 }, rows);
+					trees[i].emplace(tree, _schema);
+				}
+			};
+			unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+			threads = std::min<size_t>(threads, trees.size());
+			if (threads <= 1) {
+				worker();
+			} else {
+				std::vector<std::thread> workers;
+				for (unsigned t = 0; t < threads; t++)
+					workers.emplace_back(worker);
+				for (auto&& w : workers)
+					w.join();
+			}
+			for (auto&& t : trees) {
+				_trees.push_back(std::move(*t));
+				_trees.back().set_threads(options.threads);
+			}
+		}
+
+		const Schema& schema() const { return *_schema; }
+		const std::vector<CompiledTree>& trees() const { return _trees; }
+
+		bool classify(const Example& example) const {
+			size_t votes = 0;
+			for (auto&& t : _trees)
+				votes += t.classify(example);
+			return votes * 2 >= _trees.size();
+		}
+
+		/// @brief Classify all rows of data encoded with this forest's schema by majority vote.
+		/// Ties go to the positive class, like a tree's plurality. Row blocks are split across
+		/// Options::threads threads once, and each block is classified by every tree in turn.
+		std::vector<int> classify(const EncodedDataset& data) const {
+			constexpr size_t BLOCK_ROWS = CompiledTree::BLOCK_ROWS;
+			std::vector<int> result(data.size());
+			size_t blocks = (data.size() + BLOCK_ROWS - 1) / BLOCK_ROWS;
+			unsigned threads = _threads ? _threads : std::max(1u, std::thread::hardware_concurrency());
+			threads = std::min<size_t>(threads, blocks);
+			uint32_t n = _trees.size();
+			auto run = [&](size_t t) {
+				std::vector<uint32_t> rows, scratch;
+				std::vector<int> pred(BLOCK_ROWS);
+				std::vector<uint16_t> votes(BLOCK_ROWS);
+				for (size_t b = t; b < blocks; b += threads) {
+					size_t begin = b * BLOCK_ROWS, end = std::min(data.size(), begin + BLOCK_ROWS);
+					std::fill(votes.begin(), votes.end(), 0);
+					for (auto&& tree : _trees) {
+						tree.classify_block(data, begin, end, pred.data(), rows, scratch);
+						for (size_t i = 0; i < end - begin; i++)
+							votes[i] += pred[i];
+					}
+					for (size_t i = 0; i < end - begin; i++)
+						result[begin + i] = votes[i] * 2u >= n;
+				}
+			};
+			if (threads <= 1) {
+				run(0);
+			} else {
+				std::vector<std::thread> workers;
+				for (size_t t = 0; t < threads; t++)
+					workers.emplace_back(run, t);
+				for (auto&& w : workers)
+					w.join();
+			}
+			return result;
+		}
+
+	private:
+		static uint64_t tree_seed(uint64_t seed, size_t index) {
+			// SplitMix64 finalizer
+			uint64_t z = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+
+		std::shared_ptr<const Schema> _schema;	// One copy for all trees
+		std::vector<CompiledTree> _trees;
+		unsigned _threads;	// For batch classification, 0 for all cores
+	};
+
+} // namespace qy::ai
@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qy::ai {
+
+	/// @brief Work-stealing pool for tasks that spawn more tasks.
+	/// Every worker owns a deque: it pushes and pops its own tasks at the back (depth first, so it
+	/// keeps working on the subtree it just split) and idle workers steal from the front of others,
+	/// where the oldest and usually largest tasks are. run() returns once every task has finished.
+	class TaskPool {
+	public:
+		/// @brief A task, given the index of the worker running it.
+		using Task = std::function<void(unsigned)>;
+
+		/// @param threads Number of workers, 0 for all cores. The calling thread is worker 0.
+		explicit TaskPool(unsigned threads = 0):
+			_queues(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+		unsigned size() const { return _queues.size(); }
+
+		/// @brief Run a task and everything it spawns.
+		void run(Task root) {
+			_pending = 0;
+			_error = nullptr;
+			spawn(0, std::move(root));
+			std::vector<std::thread> threads;
+			for (unsigned w = 1; w < size(); w++)
+				threads.emplace_back([this, w] { work(w); });
+			work(0);
+			for (auto&& t : threads)
+				t.join();
+			if (_error)
+				std::rethrow_exception(_error);
+		}
+
+		/// @brief Queue a task from inside a task running on the given worker.
+		void spawn(unsigned worker, Task task) {
+			_pending.fetch_add(1, std::memory_order_relaxed);
+			{
+				std::lock_guard lock(_queues[worker].mtx);
+				_queues[worker].tasks.push_back(std::move(task));
+			}
+			_epoch.fetch_add(1, std::memory_order_release);
+			_epoch.notify_one();
+		}
+
+	private:
+		struct Queue {
+			std::mutex mtx;
+			std::deque<Task> tasks;
+		};
+
+		bool pop(unsigned worker, Task& task) {
+			Queue& q = _queues[worker];
+			std::lock_guard lock(q.mtx);
+			if (q.tasks.empty()) return false;
+			task = std::move(q.tasks.back());
+			q.tasks.pop_back();
+			return true;
+		}
+
+		bool steal(unsigned worker, Task& task) {
+			for (unsigned i = 1; i < size(); i++) {
+				Queue& q = _queues[(worker + i) % size()];
+				std::lock_guard lock(q.mtx);
+				if (q.tasks.empty()) continue;
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				return true;
+			}
+			return false;
+		}
+
+		void work(unsigned worker) {
+			Task task;
+			while (true) {
+				// Read the epoch before looking for work, so a task pushed after the search wakes the wait
+				uint32_t epoch = _epoch.load(std::memory_order_acquire);
+				if (_pending.load(std::memory_order_acquire) == 0) break;
+				if (!pop(worker, task) && !steal(worker, task)) {
+					_epoch.wait(epoch, std::memory_order_acquire);
+					continue;
+				}
+				try {
+					task(worker);
+				} catch (...) {
+					std::lock_guard lock(_error_mtx);
+					if (!_error) _error = std::current_exception();
+				}
+				task = nullptr;
+				if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					_epoch.fetch_add(1, std::memory_order_release);
+					_epoch.notify_all();
+				}
+			}
+		}
+
+		std::vector<Queue> _queues;
+		std::atomic<size_t> _pending{ 0 };
+		std::atomic<uint32_t> _epoch{ 0 };	// Bumped when a task is spawned or the last one finishes
+		std::mutex _error_mtx;
+		std::exception_ptr _error;
+	};
+
+} // namespace qy::ai
@@ -31,24 +31,33 @@ namespace qy::ai {
 		}
 	}
 
-	void print_tree(const DecisionTree::Node* root, int depth = 0) {
-		if (root->options.empty()) {
+	void print_tree(const Schema& schema, const DecisionTree::Node* root, int depth = 0) {
+		if (root->is_leaf()) {
 			print_spacer(depth);
 			std::cout << root->attribute << " = " << root->value << "\n";
 			return;
 		}
 		print_spacer(depth);
 		std::cout << "Split on " << root->attribute << " =>\n";
-		for (auto it = root->options.begin(); it != root->options.end(); ++it) {
+		if (schema.is_numeric(root->feature)) {
+			for (size_t v = 0; v < root->children.size(); v++) {
+				print_spacer(depth);
+				std::cout << "Case " << (v ? "> " : "<= ") << root->threshold << ":\n";
+				print_tree(schema, root->children[v], depth + 1);
+			}
+			return;
+		}
+		for (size_t v = 0; v < root->children.size(); v++) {
+			if (!root->children[v]) continue;
 			print_spacer(depth);
-			std::cout << "Case " << it->first << ":\n";
-			print_tree(it->second, depth + 1);
+			std::cout << "Case " << schema.dictionaries[root->feature].decode(v) << ":\n";
+			print_tree(schema, root->children[v], depth + 1);
 		}
 	}
 
 	void print_tree(const DecisionTree& tree) {
 		std::cout << "Decision Tree:\n";
-		print_tree(tree.root(), 0);
+		print_tree(tree.schema(), tree.root(), 0);
 	}
 
 	double evaluate(const std::vector<int>& pred, const std::vector<int>& gt) {
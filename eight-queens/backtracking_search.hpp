@@ -0,0 +1,382 @@
+#pragma once
+#include "csp.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+/// @brief Complete backtracking search over a binary CSP.
+/// Domains are packed bitsets stored in one flat word array. Only constrained pairs become arcs, and
+/// the support masks of a value towards its neighbours are computed the first time the value is
+/// assigned. Finding the arcs still tests every pair of variables, stopping at the first conflicting
+/// pair of values: this is cheap when most pairs are constrained, as in N-queens, but costs every
+/// pair of values of every unconstrained pair of variables. Changes are recorded on a trail and
+/// undone on backtrack, so no state is copied per node.
+template <class Variable, class Assignment>
+class BacktrackingSearch {
+public:
+	using variable_type = Variable;
+	using value_type = Variable::value_type;
+	using assignment_type = Assignment;
+	using csp_type = CSP<variable_type, assignment_type>;
+	using variable_collection = csp_type::variable_collection;
+	using word_t = uint64_t;
+
+	enum class Ordering { STATIC, MRV, MRV_DEGREE };
+	enum class Propagation { NONE, FORWARD_CHECKING, AC3 };
+
+	struct Options {
+		Ordering ordering = Ordering::MRV_DEGREE;
+		Propagation propagation = Propagation::AC3;
+	};
+
+	struct Log {
+		long long nodes;
+		long long backtracks;
+		long long solutions;
+
+		void clear() {
+			nodes = backtracks = solutions = 0;
+		}
+	};
+	Log log;
+
+	/// @brief Called with every solution found. Return true to stop the search.
+	using callback_type = std::function<bool(const assignment_type&)>;
+
+private:
+	static constexpr size_t NONE = SIZE_MAX;
+
+	struct TrailEntry {
+		int var;
+		int word;
+		word_t old;
+	};
+
+	const csp_type& csp;
+	Options options;
+
+	variable_collection vars;
+	std::vector<std::vector<value_type>> values;	// Domain values of each variable
+	size_t nvars;
+	size_t nwords;	// Words per domain
+
+	std::vector<word_t> domains;	// nvars * nwords
+	std::vector<int> domain_size;
+	size_t max_values;
+	std::vector<std::vector<int>> neighbors;
+	std::vector<size_t> arc_start;	// Arcs (x, neighbors[x][k]) are numbered arc_start[x] + k
+	std::vector<int> arc_source;
+	std::vector<int> arc_reverse;	// Arc (y, x) of arc (x, y)
+	std::vector<size_t> support_block;	// By x * max_values + a, offset into support or NONE
+	std::vector<word_t> support;	// Blocks of neighbors[x].size() * nwords: values of each neighbour compatible with x=a
+	std::vector<int> assigned;	// Assigned value index, -1 for unassigned
+	std::vector<TrailEntry> trail;
+	std::vector<int> arc_queue;
+	std::vector<char> in_queue;	// By arc
+
+public:
+	BacktrackingSearch(const csp_type& csp, Options options = {}): csp(csp), options(options) {
+		for (auto&& v : csp.initial_assignment())
+			vars.push_back(v);
+		nvars = vars.size();
+		max_values = 0;
+		for (auto&& v : vars) {
+			auto& d = values.emplace_back();
+			for (auto&& x : v.domain())
+				d.push_back(x);
+			max_values = std::max(max_values, d.size());
+		}
+		nwords = (max_values + 63) / 64;
+		build_arcs();
+	}
+
+	/// @brief Find the first solution.
+	/// @return The solution, or nullopt if the problem is proven unsatisfiable.
+	std::optional<assignment_type> operator()() {
+		std::optional<assignment_type> result;
+		for_each_solution([&](const assignment_type& a) { result.emplace(a); return true; });
+		return result;
+	}
+
+	/// @brief Count all solutions without building assignments.
+	long long count_solutions() {
+		for_each_solution(nullptr);
+		return log.solutions;
+	}
+
+	/// @brief Enumerate solutions.
+	/// @param callback Called with each solution, return true to stop. May be empty for counting only.
+	/// @return Whether the search was stopped by the callback.
+	bool for_each_solution(const callback_type& callback) {
+		log.clear();
+		reset();
+		if (options.propagation == Propagation::AC3 && !ac3_all())
+			return false;
+		return search(0, callback);
+	}
+
+private:
+	word_t* domain(int x) { return domains.data() + x * nwords; }
+
+	/// @brief Support masks of x=a towards each of its neighbours, in the order of neighbors[x].
+	/// Computed on first use; the pointer is valid until the next block is computed.
+	const word_t* supports(int x, int a) {
+		size_t& offset = support_block[x * max_values + a];
+		if (offset == NONE) {
+			offset = support.size();
+			support.resize(offset + neighbors[x].size() * nwords, 0);
+			word_t* s = support.data() + offset;
+			for (int y : neighbors[x]) {
+				for (size_t b = 0; b < values[y].size(); b++)
+					if (csp.constraint(values[x][a], values[y][b]))
+						s[b >> 6] |= (word_t)1 << (b & 63);
+				s += nwords;
+			}
+		}
+		return support.data() + offset;
+	}
+
+	/// @brief Whether some pair of values of x and y conflicts. Scans all d^2 pairs when none does.
+	bool constrained(int x, int y) const {
+		for (auto&& a : values[x])
+			for (auto&& b : values[y])
+				if (!csp.constraint(a, b) || !csp.constraint(b, a))
+					return true;
+		return false;
+	}
+
+	/// @brief Find the constrained pairs and number their arcs.
+	void build_arcs() {
+		neighbors.assign(nvars, {});
+		for (size_t x = 0; x < nvars; x++) {
+			for (size_t y = x + 1; y < nvars; y++) {
+				if (constrained(x, y)) {
+					neighbors[x].push_back(y);
+					neighbors[y].push_back(x);
+				}
+			}
+		}
+		arc_start.assign(nvars + 1, 0);
+		for (size_t x = 0; x < nvars; x++)
+			arc_start[x + 1] = arc_start[x] + neighbors[x].size();
+		arc_source.resize(arc_start[nvars]);
+		arc_reverse.resize(arc_start[nvars]);
+		for (size_t x = 0; x < nvars; x++) {
+			for (size_t k = 0; k < neighbors[x].size(); k++) {
+				int y = neighbors[x][k];
+				arc_source[arc_start[x] + k] = x;
+				// Neighbour lists are sorted, so x sits where the lower bound finds it
+				auto& back = neighbors[y];
+				arc_reverse[arc_start[x] + k] = arc_start[y] + (std::ranges::lower_bound(back, (int)x) - back.begin());
+			}
+		}
+		support_block.assign(nvars * max_values, NONE);
+	}
+
+	void reset() {
+		domains.assign(nvars * nwords, 0);
+		domain_size.resize(nvars);
+		for (size_t x = 0; x < nvars; x++) {
+			for (size_t b = 0; b < values[x].size(); b++)
+				domain(x)[b >> 6] |= (word_t)1 << (b & 63);
+			domain_size[x] = values[x].size();
+		}
+		assigned.assign(nvars, -1);
+		trail.clear();
+		in_queue.assign(arc_start[nvars], 0);
+	}
+
+	/// @brief Overwrite a domain word, recording the old value on the trail.
+	void set_word(int x, int w, word_t value) {
+		word_t& old = domain(x)[w];
+		if (old == value) return;
+		trail.push_back({ x, w, old });
+		domain_size[x] += std::popcount(value) - std::popcount(old);
+		old = value;
+	}
+
+	void undo(size_t mark) {
+		while (trail.size() > mark) {
+			auto& t = trail.back();
+			word_t& cur = domain(t.var)[t.word];
+			domain_size[t.var] += std::popcount(t.old) - std::popcount(cur);
+			cur = t.old;
+			trail.pop_back();
+		}
+	}
+
+	int next_value(int x, int from) {
+		for (size_t w = from >> 6; w < nwords; w++) {
+			word_t m = domain(x)[w];
+			if (w == (size_t)from >> 6)
+				m &= ~(word_t)0 << (from & 63);
+			if (m)
+				return w * 64 + std::countr_zero(m);
+		}
+		return -1;
+	}
+
+	/// @brief Restrict D(y) to the values set in its support mask s.
+	/// @return False if D(y) becomes empty.
+	bool restrict_to_support(const word_t* s, int y) {
+		for (size_t w = 0; w < nwords; w++)
+			set_word(y, w, domain(y)[w] & s[w]);
+		return domain_size[y] > 0;
+	}
+
+	/// @brief Remove values of x without support in D(y), for the arc (x, y).
+	/// Values whose masks are not computed yet are checked against D(y) directly, which usually
+	/// stops at the first compatible value.
+	/// @return Whether D(x) was changed.
+	bool revise(int arc) {
+		bool changed = false;
+		int x = arc_source[arc], y = neighbors[x][arc - arc_start[x]];
+		const word_t* dy = domain(y);
+		for (int a = next_value(x, 0); a != -1; a = next_value(x, a + 1)) {
+			bool supported = false;
+			if (size_t offset = support_block[x * max_values + a]; offset != NONE) {
+				const word_t* s = support.data() + offset + (arc - arc_start[x]) * nwords;
+				for (size_t w = 0; w < nwords && !supported; w++)
+					supported = (dy[w] & s[w]) != 0;
+			} else {
+				for (int b = next_value(y, 0); b != -1 && !supported; b = next_value(y, b + 1))
+					supported = csp.constraint(values[x][a], values[y][b]);
+			}
+			if (!supported) {
+				set_word(x, a >> 6, domain(x)[a >> 6] & ~((word_t)1 << (a & 63)));
+				changed = true;
+			}
+		}
+		return changed;
+	}
+
+	void push_arc(int arc) {
+		char& f = in_queue[arc];
+		if (f) return;
+		f = 1;
+		arc_queue.push_back(arc);
+	}
+
+	/// @brief Queue the arcs (z, x) of the unassigned neighbours z of x other than except.
+	void push_arcs_into(int x, int except) {
+		for (size_t e = arc_start[x]; e < arc_start[x + 1]; e++) {
+			int z = neighbors[x][e - arc_start[x]];
+			if (z != except && assigned[z] == -1)
+				push_arc(arc_reverse[e]);
+		}
+	}
+
+	/// @brief Run AC-3 over the queued arcs.
+	bool ac3() {
+		bool ok = true;
+		while (!arc_queue.empty()) {
+			int arc = arc_queue.back();
+			arc_queue.pop_back();
+			in_queue[arc] = 0;
+			if (!ok) continue;
+			if (revise(arc)) {
+				int x = arc_source[arc];
+				if (domain_size[x] == 0) {
+					ok = false;
+					continue;
+				}
+				push_arcs_into(x, neighbors[x][arc - arc_start[x]]);
+			}
+		}
+		return ok;
+	}
+
+	bool ac3_all() {
+		for (size_t arc = 0; arc < arc_start[nvars]; arc++)
+			push_arc(arc);
+		return ac3();
+	}
+
+	bool propagate(int x, int a) {
+		bool ok = propagate_impl(x, a);
+		if (!ok) {
+			for (int arc : arc_queue)
+				in_queue[arc] = 0;
+			arc_queue.clear();
+		}
+		return ok;
+	}
+
+	bool propagate_impl(int x, int a) {
+		const word_t* s = supports(x, a);
+		switch (options.propagation) {
+		case Propagation::NONE:
+			for (int y : neighbors[x]) {
+				int b = assigned[y];
+				if (b != -1 && !(s[b >> 6] >> (b & 63) & 1))
+					return false;
+				s += nwords;
+			}
+			return true;
+		case Propagation::FORWARD_CHECKING:
+			for (int y : neighbors[x]) {
+				if (assigned[y] == -1 && !restrict_to_support(s, y))
+					return false;
+				s += nwords;
+			}
+			return true;
+		case Propagation::AC3:
+			for (int y : neighbors[x]) {
+				const word_t* sy = s;
+				s += nwords;
+				if (assigned[y] != -1) continue;
+				int before = domain_size[y];
+				if (!restrict_to_support(sy, y))
+					return false;
+				if (domain_size[y] != before)
+					push_arcs_into(y, x);
+			}
+			return ac3();
+		}
+		return true;
+	}
+
+	int select_variable() const {
+		int best = -1;
+		for (size_t x = 0; x < nvars; x++) {
+			if (assigned[x] != -1) continue;
+			if (options.ordering == Ordering::STATIC)
+				return x;
+			if (best == -1 || domain_size[x] < domain_size[best]
+				|| (options.ordering == Ordering::MRV_DEGREE && domain_size[x] == domain_size[best]
+					&& neighbors[x].size() > neighbors[best].size()))
+				best = x;
+		}
+		return best;
+	}
+
+	assignment_type materialize() const {
+		variable_collection result = vars;
+		for (size_t x = 0; x < nvars; x++)
+			result[x].value = values[x][assigned[x]];
+		return result;
+	}
+
+	bool search(size_t depth, const callback_type& callback) {
+		++log.nodes;
+		if (depth == nvars) {
+			++log.solutions;
+			return callback && callback(materialize());
+		}
+		int x = select_variable();
+		for (int a = next_value(x, 0); a != -1; a = next_value(x, a + 1)) {
+			size_t mark = trail.size();
+			assigned[x] = a;
+			for (size_t w = 0; w < nwords; w++)
+				set_word(x, w, (size_t)a >> 6 == w ? (word_t)1 << (a & 63) : 0);
+			if (propagate(x, a) && search(depth + 1, callback))
+				return true;
+			undo(mark);
+			assigned[x] = -1;
+			++log.backtracks;
+		}
+		return false;
+	}
+};
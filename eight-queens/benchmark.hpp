@@ -0,0 +1,157 @@
+#pragma once
+#include "csp_queens.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <thread>
+
+/// @brief Parallel benchmark of min-conflicts on N-queens.
+/// Every trial runs once with the largest step limit and its own seed derived from (seed, n, trial),
+/// so results do not depend on the number of threads, and failures under smaller limits are read off
+/// the recorded step counts instead of re-running the search.
+struct MCSBenchmark {
+	struct Config {
+		std::vector<int> sizes;
+		std::vector<int> limits;	// Step limits to report failures for
+		int trials = 1000;
+		uint64_t seed = 114514u;
+		unsigned threads = 0;	// 0 for all cores
+		MCSQueens::Options options = {};
+	};
+
+	struct Stats {
+		int n;
+		int trials;
+		std::vector<int> failures;	// Per limit
+		// Steps and wall time (microseconds) of solved trials
+		double steps_median, steps_p90, steps_p99, steps_max;
+		double time_median, time_p90, time_p99, time_max;
+	};
+
+	Config config;
+
+	/// @brief The default grid: sizes 4..64 by 4, limits 50..500 by 50, 1000 trials.
+	static Config default_config() {
+		Config c;
+		for (int i = 4; i <= 64; i += 4) c.sizes.push_back(i);
+		for (int k = 50; k <= 500; k += 50) c.limits.push_back(k);
+		return c;
+	}
+
+	static uint64_t trial_seed(uint64_t seed, int n, int trial) {
+		// SplitMix64 finalizer
+		uint64_t z = seed + ((uint64_t)n << 32 | (uint32_t)trial) * 0x9e3779b97f4a7c15ULL;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	std::vector<Stats> run() const {
+		int max_limit = config.limits.empty() ? -1 : std::ranges::max(config.limits);
+		size_t total = config.sizes.size() * config.trials;
+		std::vector<int> steps(total);
+		std::vector<double> times(total);
+
+		// Trials of one size are contiguous, so a worker mostly keeps reusing its assignment buffers
+		std::atomic<size_t> next{ 0 };
+		auto worker = [&]() {
+			int cur_n = -1;
+			std::optional<CSPQueens> csp;
+			std::optional<QueensAssignment> initial, current;
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < total; ) {
+				int n = config.sizes[i / config.trials], trial = i % config.trials;
+				if (n != cur_n) {
+					cur_n = n;
+					csp.emplace(n);
+					initial.emplace(csp->initial_assignment());
+					current.emplace(*initial);
+				} else {
+					*current = *initial;
+				}
+				MCSQueens mcs{ *csp, (uint_fast32_t)trial_seed(config.seed, n, trial), config.options };
+				auto st = std::chrono::steady_clock::now();
+				steps[i] = mcs.run(*current, max_limit);
+				auto et = std::chrono::steady_clock::now();
+				times[i] = std::chrono::duration<double, std::micro>(et - st).count();
+			}
+		};
+		unsigned nthreads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < nthreads; i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto&& t : threads)
+			t.join();
+
+		std::vector<Stats> result;
+		for (size_t s = 0; s < config.sizes.size(); s++) {
+			Stats& st = result.emplace_back();
+			st.n = config.sizes[s];
+			st.trials = config.trials;
+			std::vector<double> solved_steps, solved_times;
+			for (size_t i = s * config.trials; i < (s + 1) * config.trials; i++) {
+				if (steps[i] < 0) continue;
+				solved_steps.push_back(steps[i]);
+				solved_times.push_back(times[i]);
+			}
+			for (int k : config.limits)
+				st.failures.push_back(std::ranges::count_if(steps.begin() + s * config.trials, steps.begin() + (s + 1) * config.trials,
+					[k](int x) { return x < 0 || x >= k; }));
+			std::ranges::sort(solved_steps);
+			std::ranges::sort(solved_times);
+			st.steps_median = quantile(solved_steps, 0.5);
+			st.steps_p90 = quantile(solved_steps, 0.9);
+			st.steps_p99 = quantile(solved_steps, 0.99);
+			st.steps_max = quantile(solved_steps, 1.0);
+			st.time_median = quantile(solved_times, 0.5);
+			st.time_p90 = quantile(solved_times, 0.9);
+			st.time_p99 = quantile(solved_times, 0.99);
+			st.time_max = quantile(solved_times, 1.0);
+		}
+		return result;
+	}
+
+	void write_csv(std::ostream& os, const std::vector<Stats>& stats) const {
+		os << "n,trials";
+		for (int k : config.limits)
+			os << ",fail_" << k;
+		os << ",steps_median,steps_p90,steps_p99,steps_max,time_median_us,time_p90_us,time_p99_us,time_max_us\n";
+		for (auto&& s : stats) {
+			os << s.n << ',' << s.trials;
+			for (int f : s.failures)
+				os << ',' << f;
+			os << ',' << s.steps_median << ',' << s.steps_p90 << ',' << s.steps_p99 << ',' << s.steps_max
+				<< ',' << s.time_median << ',' << s.time_p90 << ',' << s.time_p99 << ',' << s.time_max << '\n';
+		}
+	}
+
+	void write_json(std::ostream& os, const std::vector<Stats>& stats) const {
+		os << "{\"trials\":" << config.trials << ",\"seed\":" << config.seed << ",\"limits\":[";
+		for (size_t i = 0; i < config.limits.size(); i++)
+			os << (i ? "," : "") << config.limits[i];
+		os << "],\"results\":[";
+		for (size_t i = 0; i < stats.size(); i++) {
+			auto& s = stats[i];
+			os << (i ? "," : "") << "{\"n\":" << s.n << ",\"failures\":[";
+			for (size_t j = 0; j < s.failures.size(); j++)
+				os << (j ? "," : "") << s.failures[j];
+			os << "],\"steps\":{\"median\":" << s.steps_median << ",\"p90\":" << s.steps_p90
+				<< ",\"p99\":" << s.steps_p99 << ",\"max\":" << s.steps_max << "}"
+				<< ",\"time_us\":{\"median\":" << s.time_median << ",\"p90\":" << s.time_p90
+				<< ",\"p99\":" << s.time_p99 << ",\"max\":" << s.time_max << "}}";
+		}
+		os << "]}\n";
+	}
+
+private:
+	/// @brief Nearest-rank quantile of sorted data, 0 if empty.
+	static double quantile(const std::vector<double>& sorted, double q) {
+		if (sorted.empty()) return 0;
+		size_t k = (size_t)std::ceil(q * sorted.size());
+		return sorted[std::clamp<size_t>(k, 1, sorted.size()) - 1];
+	}
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include "solution_io.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+/// @brief Snapshot of a min-conflicts run on N-queens.
+/// File layout: "QCKP", version (u32), step (u64), n (u64), RNG state length (u64),
+/// RNG state as text, then n columns as u32. Counters are not stored, they are rebuilt on load.
+struct QueensSnapshot {
+	int step;
+	std::mt19937 rng;
+	std::vector<uint32_t> cols;
+
+	static constexpr char MAGIC[4] = { 'Q', 'C', 'K', 'P' };
+	static constexpr uint32_t VERSION = 1;
+
+	static QueensSnapshot load(const fs::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		if (in.fail())
+			throw std::runtime_error("Cannot read file: " + path.string());
+		char magic[4];
+		uint32_t version;
+		uint64_t step, n, rng_len;
+		in.read(magic, 4);
+		in.read((char*)&version, sizeof(version));
+		in.read((char*)&step, sizeof(step));
+		in.read((char*)&n, sizeof(n));
+		in.read((char*)&rng_len, sizeof(rng_len));
+		if (!in || std::memcmp(magic, MAGIC, 4) != 0 || version != VERSION)
+			throw std::runtime_error("Malformed checkpoint: " + path.string());
+		// Check the lengths against the file before allocating anything from them
+		uint64_t rest = fs::file_size(path) - (uint64_t)in.tellg();
+		if (rng_len > rest || n != (rest - rng_len) / sizeof(uint32_t) || (rest - rng_len) % sizeof(uint32_t))
+			throw std::runtime_error("Malformed checkpoint: " + path.string());
+		std::string rng_text(rng_len, '\0');
+		in.read(rng_text.data(), rng_len);
+		QueensSnapshot s{ (int)step, {}, std::vector<uint32_t>(n) };
+		in.read((char*)s.cols.data(), n * sizeof(uint32_t));
+		if (!in)
+			throw std::runtime_error("Truncated checkpoint: " + path.string());
+		std::istringstream rng_in(rng_text);
+		rng_in >> s.rng;
+		if (!rng_in || std::any_of(s.cols.begin(), s.cols.end(), [n](uint32_t c) { return c >= n; }))
+			throw std::runtime_error("Malformed checkpoint: " + path.string());
+		return s;
+	}
+};
+
+/// @brief Writes snapshots of a run from a background thread.
+/// The search thread only copies the columns; the newest pending snapshot replaces an older one
+/// that has not been written yet. Files are written to a temporary path and renamed into place.
+/// A failed write is kept and rethrown on the search thread by the next snapshot or by close().
+class QueensCheckpointer {
+	fs::path path;
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::optional<QueensSnapshot> pending;
+	bool stopping = false;
+	int written = 0;
+	std::exception_ptr error;
+	std::thread worker;
+
+public:
+	QueensCheckpointer(fs::path path): path(std::move(path)), worker([this] { loop(); }) {}
+
+	~QueensCheckpointer() {
+		stop();
+	}
+
+	/// @brief Queue a snapshot. Matches MinConflictSearch::checkpoint_type.
+	/// @throw The exception of a previous write that failed.
+	template <class Assignment>
+	void operator()(int step, const Assignment& a, const std::mt19937& rng) {
+		QueensSnapshot s{ step, rng, solution_io::columns(a) };
+		{
+			std::lock_guard lock(mtx);
+			if (error)
+				std::rethrow_exception(std::exchange(error, nullptr));
+			pending = std::move(s);
+		}
+		cv.notify_one();
+	}
+
+	/// @brief Write the pending snapshot and stop the worker.
+	/// @throw The exception of a write that failed and has not been rethrown yet.
+	void close() {
+		stop();
+		if (error)
+			std::rethrow_exception(std::exchange(error, nullptr));
+	}
+
+	/// @brief Number of snapshots written so far.
+	int count() {
+		std::lock_guard lock(mtx);
+		return written;
+	}
+
+private:
+	void stop() {
+		if (!worker.joinable()) return;
+		{
+			std::lock_guard lock(mtx);
+			stopping = true;
+		}
+		cv.notify_one();
+		worker.join();
+	}
+
+	void loop() {
+		std::unique_lock lock(mtx);
+		while (true) {
+			cv.wait(lock, [this] { return pending || stopping; });
+			if (!pending) return;
+			QueensSnapshot s = std::move(*pending);
+			pending.reset();
+			lock.unlock();
+			std::exception_ptr e;
+			try {
+				write(s);
+			} catch (...) {
+				e = std::current_exception();
+			}
+			lock.lock();
+			if (e)
+				error = e;
+			else
+				++written;
+		}
+	}
+
+	void write(const QueensSnapshot& s) const {
+		std::ostringstream ss;
+		ss << s.rng;
+		std::string rng_text = ss.str();
+		char header[4 + 4 + 8 * 3];
+		uint32_t version = QueensSnapshot::VERSION;
+		uint64_t step = s.step, n = s.cols.size(), rng_len = rng_text.size();
+		std::memcpy(header, QueensSnapshot::MAGIC, 4);
+		std::memcpy(header + 4, &version, 4);
+		std::memcpy(header + 8, &step, 8);
+		std::memcpy(header + 16, &n, 8);
+		std::memcpy(header + 24, &rng_len, 8);
+		fs::path tmp = path;
+		tmp += ".tmp";
+		solution_io::write_buffers(tmp, {
+			{ header, sizeof(header) },
+			{ rng_text.data(), rng_text.size() },
+			{ s.cols.data(), s.cols.size() * sizeof(uint32_t) } });
+		fs::rename(tmp, path);
+	}
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include "csp_queens.hpp"
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+/// @brief Queen variable view for the compact layout. It is built on the fly from the column array.
+template <class Index>
+struct CompactQueen {
+	using value_type = position;
+	int n;
+	value_type value;
+	auto domain() const {
+		return std::views::iota(0, n)
+			| std::views::transform([r = this->value.row](auto x) { return position{ r, x }; });
+	}
+};
+
+/// @brief Queen counts of the lines of one direction, one byte per line.
+/// A line rarely holds more than a few queens, so counts saturate at 255 and the exact count of a
+/// saturated line lives in a side table.
+class LineCounts {
+public:
+	using count_t = uint8_t;
+	static constexpr count_t SATURATED = std::numeric_limits<count_t>::max();
+
+	explicit LineCounts(size_t n = 0): counts(n) {}
+
+	size_t operator[] (size_t i) const {
+		return counts[i] == SATURATED ? overflow.at(i) : counts[i];
+	}
+
+	/// @return The new count.
+	size_t inc(size_t i) {
+		if (counts[i] < SATURATED - 1)
+			return ++counts[i];
+		if (counts[i] == SATURATED)
+			return ++overflow[i];
+		counts[i] = SATURATED;
+		return overflow[i] = SATURATED;
+	}
+
+	/// @return The new count.
+	size_t dec(size_t i) {
+		if (counts[i] != SATURATED)
+			return --counts[i];
+		auto it = overflow.find(i);
+		if (--it->second >= SATURATED)
+			return it->second;
+		overflow.erase(it);
+		return counts[i] = SATURATED - 1;
+	}
+
+	void clear() {
+		std::ranges::fill(counts, 0);
+		overflow.clear();
+	}
+
+private:
+	std::vector<count_t> counts;
+	std::unordered_map<size_t, size_t> overflow;	// Exact counts of saturated lines
+};
+
+/// @brief Structure-of-arrays queens assignment.
+/// Only the column of each row is stored, in a type which must be able to hold n. The line counters
+/// take one byte each, so the assignment needs sizeof(Index) + 5 bytes per queen.
+template <class Index>
+struct CompactQueensAssignment {
+	using variable_type = CompactQueen<Index>;
+
+	std::vector<Index> cols;
+	LineCounts state0, state1, state2; // Column, major diagonal, minor diagonal
+	int invalid_count;
+
+	class iterator {
+		const CompactQueensAssignment* a;
+		size_t i;
+
+		struct arrow_proxy {
+			variable_type q;
+			const variable_type* operator->() const { return &q; }
+		};
+
+	public:
+		using value_type = variable_type;
+		using difference_type = std::ptrdiff_t;
+
+		iterator(): a(nullptr), i(0) {}
+		iterator(const CompactQueensAssignment* a, size_t i): a(a), i(i) {}
+
+		variable_type operator* () const { return { (int)a->size(), position((int)i, a->cols[i]) }; }
+		arrow_proxy operator-> () const { return { **this }; }
+		iterator& operator++ () { ++i; return *this; }
+		iterator operator++ (int) { auto t = *this; ++i; return t; }
+		bool operator== (const iterator& o) const { return i == o.i; }
+	};
+
+	CompactQueensAssignment(size_t n): cols(n), state0(n), state1(n * 2 - 1), state2(n * 2 - 1), invalid_count(0) {
+		for (size_t i = 0; i < n; i++)
+			assign(i, i);
+	}
+
+	/// @brief Build from the column of each row, rebuilding the counters in linear time.
+	/// @throw std::invalid_argument if a column is not less than the number of rows.
+	template <class T>
+	static CompactQueensAssignment from_columns(const std::vector<T>& cols) {
+		CompactQueensAssignment a(cols.size());
+		a.state0.clear();
+		a.state1.clear();
+		a.state2.clear();
+		a.invalid_count = 0;
+		for (size_t i = 0; i < cols.size(); i++) {
+			if ((size_t)cols[i] >= cols.size())
+				throw std::invalid_argument("Column out of range");
+			a.assign(i, cols[i]);
+		}
+		return a;
+	}
+
+	inline void inc(LineCounts& s, size_t i) {
+		if (s.inc(i) == 2) ++invalid_count;
+	}
+
+	inline void dec(LineCounts& s, size_t i) {
+		if (s.dec(i) == 1) --invalid_count;
+	}
+
+	void assign(size_t row, size_t col) {
+		cols[row] = col;
+		inc(state0, col);
+		inc(state1, row + col);
+		inc(state2, row - col + cols.size() - 1);
+	}
+
+	void reassign(const variable_type& old, const position& value) {
+		size_t row = old.value.row, col = cols[row];
+		dec(state0, col);
+		dec(state1, row + col);
+		dec(state2, row - col + cols.size() - 1);
+		assign(row, value.col);
+	}
+
+	int get_conflicts(const position& value) const {
+		return (int)(state0[value.col]
+			+ state1[value.row + value.col]
+			+ state2[value.row - value.col + cols.size() - 1])
+			- 3;
+	}
+
+	iterator begin() const { return { this, 0 }; }
+	iterator end() const { return { this, cols.size() }; }
+	auto size() const { return cols.size(); }
+};
+
+template <class Index>
+struct CSPCompactQueens: public CSP<CompactQueen<Index>, CompactQueensAssignment<Index>> {
+	using base_type = CSP<CompactQueen<Index>, CompactQueensAssignment<Index>>;
+	using typename base_type::value_type;
+	using typename base_type::assignment_type;
+
+	int size;
+
+	CSPCompactQueens(int size): size(size) {}
+
+	assignment_type initial_assignment() const override {
+		return assignment_type(size);
+	}
+
+	bool constraint(const value_type& v1, const value_type& v2) const override {
+		return v1.col != v2.col && v1.row - v1.col != v2.row - v2.col && v1.row + v1.col != v2.row + v2.col;
+	}
+
+	bool consistent(const value_type& value, const assignment_type& assignment) const override {
+		return std::ranges::all_of(assignment, [&](auto&& q) { return q.value.row == value.row || constraint(q.value, value); });
+	}
+
+	bool is_solution(const assignment_type& assignment) const override {
+		return assignment.invalid_count == 0;
+	}
+};
+
+template <class Index>
+using MCSCompactQueens = MinConflictSearch<CompactQueen<Index>, CompactQueensAssignment<Index>>;
+
+/// @brief Call fn.template operator()<Index>() with the narrowest index type able to hold n.
+template <class Fn>
+decltype(auto) with_compact_index(size_t n, Fn&& fn) {
+	if (n <= std::numeric_limits<uint8_t>::max())
+		return fn.template operator()<uint8_t>();
+	if (n <= std::numeric_limits<uint16_t>::max())
+		return fn.template operator()<uint16_t>();
+	return fn.template operator()<uint32_t>();
+}
@@ -0,0 +1,266 @@
+#pragma once
+#include "csp.hpp"
+#include "min_conflict_search.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+/// @brief Undirected graph in CSR form. Neighbor lists are sorted and free of duplicates and self loops.
+struct Graph {
+	using vertex_t = uint32_t;
+
+	std::vector<size_t> offsets;	// n + 1
+	std::vector<vertex_t> adj;
+
+	size_t vertex_count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	size_t edge_count() const { return adj.size() / 2; }
+	size_t degree(vertex_t v) const { return offsets[v + 1] - offsets[v]; }
+
+	std::span<const vertex_t> neighbors(vertex_t v) const {
+		return { adj.data() + offsets[v], adj.data() + offsets[v + 1] };
+	}
+
+	bool adjacent(vertex_t u, vertex_t v) const {
+		return std::ranges::binary_search(neighbors(u), v);
+	}
+
+	static Graph from_edges(size_t n, const std::vector<std::pair<vertex_t, vertex_t>>& edges) {
+		Graph g;
+		g.offsets.assign(n + 1, 0);
+		for (auto [u, v] : edges) {
+			if (u == v) continue;
+			++g.offsets[u + 1];
+			++g.offsets[v + 1];
+		}
+		for (size_t i = 0; i < n; i++)
+			g.offsets[i + 1] += g.offsets[i];
+		g.adj.resize(g.offsets[n]);
+		std::vector<size_t> fill(g.offsets.begin(), g.offsets.end() - 1);
+		for (auto [u, v] : edges) {
+			if (u == v) continue;
+			g.adj[fill[u]++] = v;
+			g.adj[fill[v]++] = u;
+		}
+		// Sort and deduplicate each row, compacting in place
+		size_t out = 0;
+		for (size_t i = 0; i < n; i++) {
+			auto first = g.adj.begin() + g.offsets[i], last = g.adj.begin() + g.offsets[i + 1];
+			std::sort(first, last);
+			last = std::unique(first, last);
+			g.offsets[i] = out;
+			out = std::copy(first, last, g.adj.begin() + out) - g.adj.begin();
+		}
+		g.offsets[n] = out;
+		g.adj.resize(out);
+		g.adj.shrink_to_fit();
+		return g;
+	}
+
+	/// @brief Read a whitespace separated edge list, one "u v" pair per line.
+	/// Lines starting with '#' or '%' are comments. Vertex count is the largest id plus one.
+	static Graph read_edge_list(const std::filesystem::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		if (in.fail())
+			throw std::runtime_error("Cannot read file: " + path.string());
+		std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		std::vector<std::pair<vertex_t, vertex_t>> edges;
+		size_t n = 0;
+		const char* p = text.data(), * end = p + text.size();
+		auto skip_space = [&]() { while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p; };
+		while (p < end) {
+			skip_space();
+			if (p == end)
+				break;	// Blank last line without a newline
+			if (*p == '#' || *p == '%' || *p == '\n') {
+				p = std::find(p, end, '\n');
+				if (p < end) ++p;
+				continue;
+			}
+			vertex_t u = 0, v = 0;
+			auto r1 = std::from_chars(p, end, u);
+			p = r1.ptr;
+			skip_space();
+			auto r2 = std::from_chars(p, end, v);
+			if (r1.ec != std::errc() || r2.ec != std::errc())
+				throw std::runtime_error("Malformed edge list: " + path.string());
+			p = std::find(r2.ptr, end, '\n');
+			if (p < end) ++p;
+			edges.emplace_back(u, v);
+			n = std::max<size_t>(n, std::max(u, v) + 1);
+		}
+		return from_edges(n, edges);
+	}
+
+	/// @brief Uniform random graph with n vertices and about m edges.
+	static Graph random(size_t n, size_t m, uint64_t seed) {
+		std::mt19937_64 rng(seed);
+		std::uniform_int_distribution<vertex_t> dist(0, n - 1);
+		std::vector<std::pair<vertex_t, vertex_t>> edges(m);
+		for (auto& e : edges)
+			e = { dist(rng), dist(rng) };
+		return from_edges(n, edges);
+	}
+};
+
+struct vertex_color {
+	int vertex;
+	int color;
+
+	vertex_color(): vertex(-1), color(-1) {}
+	vertex_color(int vertex, int color): vertex(vertex), color(color) {}
+
+	bool operator== (const vertex_color& o) const = default;
+};
+
+struct Vertex {
+	using value_type = vertex_color;
+	int k;
+	value_type value;
+	auto domain() const {
+		return std::views::iota(0, k)
+			| std::views::transform([v = this->value.vertex](auto c) { return vertex_color{ v, c }; });
+	}
+};
+
+/// @brief Colouring of a graph with per-vertex, per-colour counts of neighbours in that colour.
+/// A move updates the counts of the moved vertex's neighbours only, so it costs O(degree).
+/// Vertices with conflicts are kept in an indexed list so the search never scans the whole graph.
+struct ColoringAssignment {
+	using color_t = uint16_t;
+
+	const Graph* graph;
+	int k;
+	std::vector<color_t> colors;
+	std::vector<uint32_t> state;	// n * k, neighbours of v in colour c
+	std::vector<uint32_t> conflicted_list;
+	std::vector<int64_t> conflicted_pos;	// Position in conflicted_list, -1 if absent
+	long long invalid_count;	// Number of conflicting edges
+
+	class iterator {
+		const ColoringAssignment* a;
+		size_t i;
+
+		struct arrow_proxy {
+			Vertex v;
+			const Vertex* operator->() const { return &v; }
+		};
+
+	public:
+		using value_type = Vertex;
+		using difference_type = std::ptrdiff_t;
+
+		iterator(): a(nullptr), i(0) {}
+		iterator(const ColoringAssignment* a, size_t i): a(a), i(i) {}
+
+		Vertex operator* () const { return { a->k, vertex_color((int)i, a->colors[i]) }; }
+		arrow_proxy operator-> () const { return { **this }; }
+		iterator& operator++ () { ++i; return *this; }
+		iterator operator++ (int) { auto t = *this; ++i; return t; }
+		bool operator== (const iterator& o) const { return i == o.i; }
+	};
+
+	/// @brief Build from a colouring, computing all counts in O(n * k + m).
+	ColoringAssignment(const Graph& graph, int k, std::vector<color_t> colors):
+		graph(&graph), k(k), colors(std::move(colors)), state(graph.vertex_count() * k),
+		conflicted_pos(graph.vertex_count(), -1), invalid_count(0)
+	{
+		size_t n = graph.vertex_count();
+		for (size_t v = 0; v < n; v++)
+			for (auto u : graph.neighbors(v))
+				++state[(size_t)u * k + this->colors[v]];
+		for (size_t v = 0; v < n; v++) {
+			invalid_count += state[v * k + this->colors[v]];
+			update_conflicted(v);
+		}
+		invalid_count /= 2;
+	}
+
+	void reassign(const Vertex& old, const vertex_color& value) {
+		size_t v = old.value.vertex;
+		color_t from = colors[v], to = value.color;
+		if (from == to) return;
+		invalid_count += (long long)state[v * k + to] - state[v * k + from];
+		colors[v] = to;
+		for (auto u : graph->neighbors(v)) {
+			--state[(size_t)u * k + from];
+			++state[(size_t)u * k + to];
+			if (colors[u] == from || colors[u] == to)
+				update_conflicted(u);
+		}
+		update_conflicted(v);
+	}
+
+	int get_conflicts(const vertex_color& value) const {
+		return state[(size_t)value.vertex * k + value.color];
+	}
+
+	const std::vector<uint32_t>& conflicted() const { return conflicted_list; }
+	iterator variable_at(size_t i) const { return { this, i }; }
+
+	iterator begin() const { return { this, 0 }; }
+	iterator end() const { return { this, colors.size() }; }
+	auto size() const { return colors.size(); }
+
+private:
+	void update_conflicted(size_t v) {
+		bool c = state[v * k + colors[v]] > 0;
+		int64_t& pos = conflicted_pos[v];
+		if (c && pos == -1) {
+			pos = conflicted_list.size();
+			conflicted_list.push_back(v);
+		} else if (!c && pos != -1) {
+			conflicted_pos[conflicted_list.back()] = pos;
+			conflicted_list[pos] = conflicted_list.back();
+			conflicted_list.pop_back();
+			pos = -1;
+		}
+	}
+};
+
+struct CSPColoring: public CSP<Vertex, ColoringAssignment> {
+	const Graph& graph;
+	int k;
+
+	CSPColoring(const Graph& graph, int k): graph(graph), k(k) {
+		if (k < 1 || k > std::numeric_limits<ColoringAssignment::color_t>::max())
+			throw std::invalid_argument("Invalid number of colours");
+	}
+
+	/// @brief Greedy colouring in vertex order, each vertex taking its least conflicting colour.
+	assignment_type initial_assignment() const override {
+		size_t n = graph.vertex_count();
+		std::vector<ColoringAssignment::color_t> colors(n);
+		std::vector<size_t> used(k);
+		std::vector<char> assigned(n, 0);
+		for (size_t v = 0; v < n; v++) {
+			std::ranges::fill(used, 0);
+			for (auto u : graph.neighbors(v))
+				if (assigned[u])
+					++used[colors[u]];
+			colors[v] = std::ranges::min_element(used) - used.begin();
+			assigned[v] = 1;
+		}
+		return { graph, k, std::move(colors) };
+	}
+
+	bool constraint(const value_type& v1, const value_type& v2) const override {
+		return v1.color != v2.color || v1.vertex == v2.vertex || !graph.adjacent(v1.vertex, v2.vertex);
+	}
+
+	bool consistent(const value_type& value, const assignment_type& assignment) const override {
+		return std::ranges::none_of(graph.neighbors(value.vertex), [&](auto u) { return assignment.colors[u] == value.color; });
+	}
+
+	bool is_solution(const assignment_type& assignment) const override {
+		return assignment.invalid_count == 0;
+	}
+};
+
+using MCSColoring = MinConflictSearch<Vertex, ColoringAssignment>;
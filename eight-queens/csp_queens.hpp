@@ -1,6 +1,8 @@
 #pragma once
 #include "csp.hpp"
 #include "min_conflict_search.hpp"
+#include "backtracking_search.hpp"
+#include <algorithm>
 #include <ranges>
 
 struct position {
@@ -38,6 +40,18 @@ struct QueensAssignment {
 			assign(this->vars[i], vars[i].value);
 	}
 
+	/// @brief Build from the column of each row, rebuilding the counters in linear time.
+	template <class T>
+	static QueensAssignment from_columns(const std::vector<T>& cols) {
+		std::vector<Queen> vars;
+		vars.reserve(cols.size());
+		for (size_t i = 0; i < cols.size(); i++) {
+			vars.emplace_back(cols.size(), i);
+			vars.back().value.col = cols[i];
+		}
+		return vars;
+	}
+
 	inline void inc(std::vector<int>& s, int i) {
 		if (++s[i] == 2) ++invalid_count;
 	}
@@ -86,14 +100,12 @@ struct CSPQueens: public CSP<Queen, QueensAssignment> {
 		return vars;
 	}
 
-	// Not used
 	bool constraint(const value_type& v1, const value_type& v2) const override {
 		return v1.col != v2.col && v1.row - v1.col != v2.row - v2.col && v1.row + v1.col != v2.row + v2.col;
 	}
 
-	// Not used
 	bool consistent(const value_type& value, const assignment_type& assignment) const override {
-		return false;
+		return std::ranges::all_of(assignment, [&](auto&& q) { return q.value.row == value.row || constraint(q.value, value); });
 	}
 
 	bool is_solution(const assignment_type& assignment) const override {
@@ -102,3 +114,4 @@ struct CSPQueens: public CSP<Queen, QueensAssignment> {
 };
 
 using MCSQueens = MinConflictSearch<Queen, QueensAssignment>;
+using BTSQueens = BacktrackingSearch<Queen, QueensAssignment>;
@@ -1,18 +1,22 @@
 #pragma GCC optimize(3)
 #include "csp_queens.hpp"
+#include "compact_queens.hpp"
+#include "benchmark.hpp"
+#include "csp_coloring.hpp"
+#include "queens_counter.hpp"
+#include "solution_io.hpp"
+#include "checkpoint.hpp"
 #include <iostream>
+#include <mutex>
 
 void print_solution(const QueensAssignment& a) {
-	for (int i = 0; auto && q : a) {
-		for (int j = 0; j < a.size(); j++)
-			std::cout << ".@"[j == q.value.col];
-		std::cout << '\n';
-		i++;
-	}
+	auto board = solution_io::to_board(solution_io::columns(a));
+	fwrite(board.data(), 1, board.size(), stdout);
 }
 
 void single_display(int n, int print_level = 0) {
-	auto mcs = MCSQueens(CSPQueens(n));
+	CSPQueens csp{ n };
+	MCSQueens mcs{ csp };
 	auto st = std::chrono::high_resolution_clock::now();
 	auto sol = mcs(-1);
 	auto et = std::chrono::high_resolution_clock::now();
@@ -20,33 +24,142 @@ void single_display(int n, int print_level = 0) {
 	printf("steps: %d\n", sol.first);
 	printf("duration: %.3fms\n", dur / 1e3);
 	if (print_level <= 1) {
-		for (auto x : sol.second)
-			printf("(%d,%d) ", x.value.row, x.value.col);
-		printf("\n");
+		auto text = solution_io::to_text(solution_io::columns(sol.second));
+		fwrite(text.data(), 1, text.size(), stdout);
 		if (sol.first > 0 && print_level <= 0)
 			print_solution(sol.second);
 	}
 }
 
-void benchmark_steps() {
-	for (int i = 4; i <= 64; i += 4) { // Number of queens
-		CSPQueens csp{ i };
-		MCSQueens mcs{ csp, 114514u };
-		printf("%d", i);
-		for (int k = 50; k <= 500; k += 50) {
-			int failures = 0;
-			for (int j = 0; j < 1000; j++) {
-				auto sol = mcs(k);
-				failures += sol.first == -1;
-			}
-			printf("\t%d", failures);
+/// @brief Solve with the compact layout, for very large n.
+/// @param output Path to export the solution to, or empty. A ".txt" extension selects the text format.
+void compact_display(int n, const fs::path& output = {}) {
+	with_compact_index(n, [&]<class Index>() {
+		CSPCompactQueens<Index> csp{ n };
+		MCSCompactQueens<Index> mcs{ csp };
+		auto st = std::chrono::high_resolution_clock::now();
+		auto sol = mcs(-1);
+		auto et = std::chrono::high_resolution_clock::now();
+		auto dur = std::chrono::duration_cast<std::chrono::microseconds>(et - st).count();
+		printf("index bytes: %zu\n", sizeof(Index));
+		printf("steps: %d\n", sol.first);
+		printf("duration: %.3fms\n", dur / 1e3);
+		if (!output.empty() && sol.first >= 0) {
+			auto cols = solution_io::columns(sol.second);
+			if (output.extension() == ".txt")
+				solution_io::write_text(output, cols);
+			else
+				solution_io::write_binary(output, cols);
+			printf("verified: %s\n", solution_io::verify_file(output) ? "yes" : "no");
+		}
+	});
+}
+
+/// @brief Solve with the compact layout, snapshotting every interval steps and resuming from an existing snapshot.
+void checkpointed_display(int n, const fs::path& checkpoint, int interval = 100000) {
+	with_compact_index(n, [&]<class Index>() {
+		CSPCompactQueens<Index> csp{ n };
+		MCSCompactQueens<Index> mcs{ csp };
+		std::optional<CompactQueensAssignment<Index>> current;
+		int first_step = 0;
+		if (fs::exists(checkpoint)) {
+			auto snap = QueensSnapshot::load(checkpoint);
+			if (snap.cols.size() != (size_t)n)
+				throw std::runtime_error("Checkpoint size mismatch: " + checkpoint.string());
+			mcs.set_rng(snap.rng);
+			current.emplace(CompactQueensAssignment<Index>::from_columns(snap.cols));
+			first_step = snap.step;
+			printf("resumed at step %d\n", first_step);
+		} else {
+			current.emplace(csp.initial_assignment());
 		}
-		printf("\n");
+		QueensCheckpointer writer{ checkpoint };
+		mcs.set_checkpoint(interval, [&](int step, const auto& a, const auto& rng) { writer(step, a, rng); });
+		auto st = std::chrono::high_resolution_clock::now();
+		int steps = mcs.run(*current, -1, first_step);
+		writer.close();
+		auto et = std::chrono::high_resolution_clock::now();
+		auto dur = std::chrono::duration_cast<std::chrono::microseconds>(et - st).count();
+		printf("steps: %d\n", steps);
+		printf("duration: %.3fms\n", dur / 1e3);
+	});
+}
+
+/// @brief Colour a graph with k colours.
+/// @param graph_file Edge list file, or empty for a random graph with n vertices and 3n edges.
+void coloring_display(const std::string& graph_file, int k, int n = 1000000) {
+	Graph g = graph_file.empty() ? Graph::random(n, n * 3ull, 114514u) : Graph::read_edge_list(graph_file);
+	printf("vertices: %zu, edges: %zu\n", g.vertex_count(), g.edge_count());
+	CSPColoring csp{ g, k };
+	MCSColoring mcs{ csp, 114514u, { .walk_probability = 0.02, .random_variable = true } };
+	auto st = std::chrono::high_resolution_clock::now();
+	auto sol = mcs(-1);
+	auto et = std::chrono::high_resolution_clock::now();
+	auto dur = std::chrono::duration_cast<std::chrono::microseconds>(et - st).count();
+	printf("steps: %d\n", sol.first);
+	printf("duration: %.3fms\n", dur / 1e3);
+}
+
+/// @brief Benchmark failures under step limits and the distribution of steps and time.
+/// @param json Output JSON instead of CSV.
+void benchmark_steps(MCSQueens::Options options = {}, bool json = false) {
+	auto config = MCSBenchmark::default_config();
+	config.options = options;
+	MCSBenchmark bench{ config };
+	auto stats = bench.run();
+	if (json)
+		bench.write_json(std::cout, stats);
+	else
+		bench.write_csv(std::cout, stats);
+}
+
+void backtracking_display(int n, BTSQueens::Options options = {}, bool count_all = false) {
+	CSPQueens csp{ n };
+	BTSQueens bts{ csp, options };
+	auto st = std::chrono::high_resolution_clock::now();
+	if (count_all) {
+		auto cnt = bts.count_solutions();
+		printf("solutions: %lld\n", cnt);
+	} else {
+		auto sol = bts();
+		if (sol) print_solution(*sol);
+		else printf("No solution\n");
 	}
+	auto et = std::chrono::high_resolution_clock::now();
+	auto dur = std::chrono::duration_cast<std::chrono::microseconds>(et - st).count();
+	printf("nodes: %lld, backtracks: %lld\n", bts.log.nodes, bts.log.backtracks);
+	printf("duration: %.3fms\n", dur / 1e3);
+}
+
+void all_solutions(int n, bool print = false) {
+	QueensCounter counter{ n };
+	auto st = std::chrono::high_resolution_clock::now();
+	uint64_t cnt;
+	if (print) {
+		std::mutex mtx;
+		cnt = counter.for_each_solution([&](const std::vector<int>& cols) {
+			std::lock_guard lock(mtx);
+			for (int c : cols)
+				printf("%d ", c);
+			printf("\n");
+		});
+	} else {
+		cnt = counter.count();
+	}
+	auto et = std::chrono::high_resolution_clock::now();
+	auto dur = std::chrono::duration_cast<std::chrono::microseconds>(et - st).count();
+	printf("solutions: %llu\n", (unsigned long long)cnt);
+	printf("duration: %.3fms\n", dur / 1e3);
 }
 
 int main() {
 	// benchmark_steps();
+	// benchmark_steps({ .tabu_tenure = 2 });
+	// backtracking_display(8, {}, true);
+	// all_solutions(16);
+	// compact_display(100000, "solution.bin");
+	// coloring_display("", 5);
+	// checkpointed_display(1000000, "queens.ckpt");
 	single_display(10000, 2);
 	return 0;
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include "csp.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <random>
 
 template <class Variable, class Assignment>
@@ -10,44 +13,194 @@ public:
 	using value_type = Variable::value_type;
 	using assignment_type = Assignment;
 	using csp_type = CSP<variable_type, assignment_type>;
+
+	enum class Restart { NONE, FIXED, LUBY, GEOMETRIC };
+
+	struct Options {
+		int tabu_tenure = 0;	// Steps a moved variable may not be chosen again, 0 to disable
+		double walk_probability = 0.0;	// Probability of assigning a random value instead of the best one
+		Restart restart = Restart::NONE;
+		int restart_base = 100;	// Length unit of restart intervals
+		double restart_factor = 1.5;	// Growth of geometric restart intervals
+		bool random_variable = false;	// Pick a uniformly random conflicting variable instead of the most conflicting one
+	};
+
+	/// @brief Receives the state at the start of a step: the step index, the assignment and the RNG.
+	using checkpoint_type = std::function<void(int, const assignment_type&, const std::mt19937&)>;
+
 private:
 	const csp_type& csp;
 	std::mt19937 rng;
+	Options options;
+	std::vector<int> last_moved;	// Step when each variable was last reassigned
+	int checkpoint_interval = 0;
+	checkpoint_type checkpoint;
 
 public:
-	MinConflictSearch(const csp_type& csp, uint_fast32_t seed): csp(csp), rng(seed) {}
+	MinConflictSearch(const csp_type& csp, uint_fast32_t seed, Options options = {}): csp(csp), rng(seed), options(options) {}
 	MinConflictSearch(const csp_type& csp): MinConflictSearch(csp, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) {}
 
+	void set_options(const Options& options) { this->options = options; }
+	const Options& get_options() const { return options; }
+
+	void set_rng(const std::mt19937& rng) { this->rng = rng; }
+
+	/// @brief Call fn every interval steps during run, 0 to disable.
+	void set_checkpoint(int interval, checkpoint_type fn) {
+		checkpoint_interval = interval;
+		checkpoint = std::move(fn);
+	}
+
+	/// @brief Run the search.
+	/// @param max_steps Limit of total steps over all restarts, -1 for no limit.
+	/// @return Steps used (-1 on failure) and the final assignment.
 	std::pair<int, assignment_type> operator()(int max_steps = -1) {
 		assignment_type current = csp.initial_assignment();
+		int steps = run(current, max_steps);
+		return { steps, std::move(current) };
+	}
+
+	/// @brief Run the search in place from a given assignment.
+	/// To resume from a checkpoint, pass its assignment and step after restoring the RNG with set_rng.
+	/// Resuming is exact except that tabu memory starts empty.
+	/// @param current Start assignment, holds the final assignment on return.
+	/// @param max_steps Limit of total steps over all restarts, -1 for no limit.
+	/// @param first_step Index of the first step.
+	/// @return Steps used, -1 on failure.
+	int run(assignment_type& current, int max_steps = -1, int first_step = 0) {
 		if (max_steps == -1)
 			max_steps = std::numeric_limits<int>::max();
-		for (int i = 0; i < max_steps; i++) {
+		last_moved.assign(options.tabu_tenure ? current.size() : 0, std::numeric_limits<int>::min() / 2);
+		std::bernoulli_distribution walk(options.walk_probability);
+		int restarts = 0;
+		long long next_restart = restart_interval(restarts);
+		while (next_restart < first_step)
+			next_restart += restart_interval(++restarts);
+		for (int i = first_step; i < max_steps; i++) {
+			if (checkpoint_interval && i > first_step && i % checkpoint_interval == 0)
+				checkpoint(i, current, rng);
 			if (csp.is_solution(current))
-				return { i, current };
-			auto var = choose_conflict_variable(current);
-			auto value = get_min_conflict_value(*var, current);
-			if (var != current.end())
-				current.reassign(*var, value);
+				return i;
+			if (i == next_restart) {
+				randomize(current);
+				std::ranges::fill(last_moved, std::numeric_limits<int>::min() / 2);
+				next_restart += restart_interval(++restarts);
+			}
+			auto [var, idx] = choose_conflict_variable(current, i);
+			if (var == current.end())
+				continue;
+			auto value = options.walk_probability > 0 && walk(rng)
+				? get_random_value(*var)
+				: get_min_conflict_value(*var, current);
+			current.reassign(*var, value);
+			if (options.tabu_tenure)
+				last_moved[idx] = i;
 		}
-		return { -1, current };
+		return -1;
+	}
+
+	/// @brief The i-th term (0-based) of the Luby sequence 1,1,2,1,1,2,4,...
+	static long long luby(int i) {
+		long long size = 1;
+		int seq = 0;
+		while (size < i + 1) {
+			size = size * 2 + 1;
+			++seq;
+		}
+		while (size - 1 != i) {
+			size = (size - 1) >> 1;
+			--seq;
+			i %= size;
+		}
+		return 1LL << seq;
 	}
 
 private:
-	auto choose_conflict_variable(assignment_type& assignment) {
+	/// @return Steps before the next restart, or a value never reached when restarts are disabled.
+	long long restart_interval(int restarts) const {
+		switch (options.restart) {
+		case Restart::FIXED:
+			return options.restart_base;
+		case Restart::LUBY:
+			return options.restart_base * luby(restarts);
+		case Restart::GEOMETRIC:
+			return std::max(1LL, (long long)(options.restart_base * std::pow(options.restart_factor, restarts)));
+		default:
+			return std::numeric_limits<long long>::max() / 2;
+		}
+	}
+
+	/// @brief Reassign every variable to a random value of its domain, so each restart starts from
+	/// a different point drawn from the engine.
+	void randomize(assignment_type& assignment) {
+		for (auto it = assignment.begin(); it != assignment.end(); ++it)
+			assignment.reassign(*it, get_random_value(*it));
+	}
+
+	bool is_tabu(size_t idx, int step) const {
+		return options.tabu_tenure && step - last_moved[idx] <= options.tabu_tenure;
+	}
+
+	/// @brief Choose a variable with the most conflicts, ties broken randomly, or with random_variable
+	/// any conflicting variable with equal probability.
+	/// Assignments that track their conflicting variables (`conflicted()` and `variable_at(i)`)
+	/// are sampled or scanned only over those, otherwise every variable is scanned.
+	auto choose_conflict_variable(assignment_type& assignment, int step) {
+		using iterator = decltype(assignment.begin());
+		if constexpr (requires { assignment.conflicted(); assignment.variable_at(0); }) {
+			auto&& list = assignment.conflicted();
+			if (options.random_variable && !list.empty()) {
+				// A few retries to avoid tabu variables
+				size_t idx = list[rng() % list.size()];
+				for (int t = 0; t < 8 && is_tabu(idx, step); t++)
+					idx = list[rng() % list.size()];
+				return std::pair{ assignment.variable_at(idx), idx };
+			}
+		}
 		int max_conflicts = 0, cnt = 0;
 		auto result = assignment.end();
-		for (auto it = assignment.begin(); it != assignment.end(); ++it) {
+		size_t result_idx = 0;
+		// Fallback when every conflicting variable is tabu
+		int tabu_max = 0, tabu_cnt = 0;
+		auto tabu_result = assignment.end();
+		size_t tabu_idx = 0;
+		auto consider = [&](iterator it, size_t idx) {
 			int conf = assignment.get_conflicts(it->value);
+			if (options.random_variable)
+				conf = conf > 0;
+			if (is_tabu(idx, step)) {
+				if (conf > tabu_max) {
+					tabu_max = conf;
+					tabu_cnt = 1;
+					tabu_result = it;
+					tabu_idx = idx;
+				} else if (conf == tabu_max && conf > 0 && rng() % ++tabu_cnt == 0) {
+					tabu_result = it;
+					tabu_idx = idx;
+				}
+				return;
+			}
 			if (conf > max_conflicts) {
 				max_conflicts = conf;
 				cnt = 1;
 				result = it;
+				result_idx = idx;
 			} else if (conf == max_conflicts && rng() % ++cnt == 0) {
 				result = it;
+				result_idx = idx;
 			}
+		};
+		if constexpr (requires { assignment.conflicted(); assignment.variable_at(0); }) {
+			for (auto idx : assignment.conflicted())
+				consider(assignment.variable_at(idx), idx);
+		} else {
+			size_t idx = 0;
+			for (auto it = assignment.begin(); it != assignment.end(); ++it, ++idx)
+				consider(it, idx);
 		}
-		return result;
+		if (result == assignment.end() || (max_conflicts == 0 && tabu_max > 0))
+			return std::pair{ tabu_result, tabu_idx };
+		return std::pair{ result, result_idx };
 	}
 
 	value_type get_min_conflict_value(const variable_type& var, const assignment_type& assignment) {
@@ -66,4 +219,10 @@ private:
 		return val;
 	}
 
-};
\ No newline at end of file
+	value_type get_random_value(const variable_type& var) {
+		auto domain = var.domain();
+		auto k = std::uniform_int_distribution<long long>(0, std::ranges::distance(domain) - 1)(rng);
+		return *std::ranges::next(domain.begin(), k);
+	}
+
+};
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/// @brief Exhaustive N-queens solver using column and diagonal bitmasks.
+/// Only the left half of the first row is searched and every result is mirrored.
+/// The first rows are expanded into independent tasks that worker threads take from a shared counter.
+class QueensCounter {
+public:
+	using mask_t = uint32_t;
+	/// @brief Receives the column of the queen in each row. Called concurrently from worker threads.
+	using callback_type = std::function<void(const std::vector<int>&)>;
+
+private:
+	struct Task {
+		mask_t cols, ld, rd;
+		int row;
+		int weight;	// 2 if the mirrored solutions are not searched separately
+		int prefix[3];
+	};
+
+	int n;
+	mask_t full;
+	int split_depth;
+	unsigned nthreads;
+
+public:
+	/// @param n Board size, at most 32.
+	/// @param nthreads Number of worker threads, 0 for all cores.
+	QueensCounter(int n, unsigned nthreads = 0): n(n), full(n >= 32 ? ~(mask_t)0 : ((mask_t)1 << n) - 1) {
+		if (n < 1 || n > 32)
+			throw std::invalid_argument("Board size must be in [1, 32]");
+		split_depth = std::min(n, n >= 12 ? 3 : 2);
+		this->nthreads = nthreads ? nthreads : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	/// @brief Count all solutions.
+	uint64_t count() const {
+		return run(nullptr);
+	}
+
+	/// @brief Enumerate all solutions, including mirrored ones.
+	/// @return Number of solutions.
+	uint64_t for_each_solution(const callback_type& callback) const {
+		return run(callback);
+	}
+
+private:
+	std::vector<Task> make_tasks() const {
+		std::vector<Task> tasks;
+		Task t{ 0, 0, 0, 0, 2, {} };
+		// First queen on the left half, mirrored solutions counted twice
+		for (int c = 0; c < n / 2; c++)
+			expand(tasks, t, c);
+		if (n & 1) {
+			// First queen in the middle column, second queen on the left half
+			Task m = place(t, n / 2);
+			if (n == 1) {
+				m.weight = 1;
+				tasks.push_back(m);
+			} else {
+				for (int c = 0; c < n / 2; c++)
+					expand(tasks, m, c);
+			}
+		}
+		return tasks;
+	}
+
+	Task place(const Task& t, int c) const {
+		mask_t b = (mask_t)1 << c;
+		Task r = t;
+		r.cols = t.cols | b;
+		r.ld = ((t.ld | b) << 1) & full;
+		r.rd = (t.rd | b) >> 1;
+		r.prefix[t.row] = c;
+		r.row = t.row + 1;
+		return r;
+	}
+
+	void expand(std::vector<Task>& tasks, const Task& t, int c) const {
+		mask_t b = (mask_t)1 << c;
+		if ((t.cols | t.ld | t.rd) & b)
+			return;
+		Task r = place(t, c);
+		if (r.row >= split_depth) {
+			tasks.push_back(r);
+			return;
+		}
+		for (mask_t bits = ~(r.cols | r.ld | r.rd) & full; bits; bits &= bits - 1)
+			expand(tasks, r, std::countr_zero(bits));
+	}
+
+	uint64_t solve(mask_t cols, mask_t ld, mask_t rd) const {
+		if (cols == full)
+			return 1;
+		uint64_t s = 0;
+		for (mask_t bits = ~(cols | ld | rd) & full; bits; bits &= bits - 1) {
+			mask_t b = bits & -bits;
+			s += solve(cols | b, ((ld | b) << 1) & full, (rd | b) >> 1);
+		}
+		return s;
+	}
+
+	uint64_t solve(mask_t cols, mask_t ld, mask_t rd, int row, std::vector<int>& queens, int weight, const callback_type& callback) const {
+		if (cols == full) {
+			callback(queens);
+			if (weight == 2) {
+				std::vector<int> mirrored(queens.size());
+				for (size_t i = 0; i < queens.size(); i++)
+					mirrored[i] = n - 1 - queens[i];
+				callback(mirrored);
+			}
+			return weight;
+		}
+		uint64_t s = 0;
+		for (mask_t bits = ~(cols | ld | rd) & full; bits; bits &= bits - 1) {
+			mask_t b = bits & -bits;
+			queens[row] = std::countr_zero(b);
+			s += solve(cols | b, ((ld | b) << 1) & full, (rd | b) >> 1, row + 1, queens, weight, callback);
+		}
+		return s;
+	}
+
+	uint64_t run(const callback_type& callback) const {
+		std::vector<Task> tasks = make_tasks();
+		std::atomic<size_t> next{ 0 };
+		std::atomic<uint64_t> total{ 0 };
+		auto worker = [&]() {
+			uint64_t local = 0;
+			std::vector<int> queens(n);
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < tasks.size(); ) {
+				const Task& t = tasks[i];
+				if (callback) {
+					std::copy(t.prefix, t.prefix + t.row, queens.begin());
+					local += solve(t.cols, t.ld, t.rd, t.row, queens, t.weight, callback);
+				} else {
+					local += solve(t.cols, t.ld, t.rd) * t.weight;
+				}
+			}
+			total += local;
+		};
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < nthreads; i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto&& t : threads)
+			t.join();
+		return total;
+	}
+};
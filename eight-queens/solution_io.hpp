@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if __has_include(<sys/uio.h>)
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define QUEENS_HAVE_WRITEV 1
+#endif
+
+/// @brief Export and verification of N-queens solutions as a column permutation.
+/// The binary format is a 16-byte header ("QSOL", then version, element width and n as 2-, 2- and
+/// 8-byte little-endian integers) followed by the column of each row as little-endian integers of
+/// the narrowest sufficient width, whatever the byte order of the host.
+/// The text format is the columns separated by spaces on one line.
+namespace solution_io {
+
+	namespace fs = std::filesystem;
+
+	constexpr char MAGIC[4] = { 'Q', 'S', 'O', 'L' };
+	constexpr uint16_t VERSION = 1;
+
+	struct Header {
+		char magic[4];
+		uint16_t version;
+		uint16_t width;	// Bytes per column
+		uint64_t n;
+	};
+	constexpr size_t HEADER_SIZE = 16;
+
+	/// @brief Store the low width bytes of v at p, least significant first.
+	inline void put_le(unsigned char* p, uint64_t v, int width) {
+		for (int b = 0; b < width; b++)
+			p[b] = v >> (b * 8) & 0xff;
+	}
+
+	/// @brief Load width bytes stored least significant first at p.
+	inline uint64_t get_le(const unsigned char* p, int width) {
+		uint64_t v = 0;
+		for (int b = 0; b < width; b++)
+			v |= (uint64_t)p[b] << (b * 8);
+		return v;
+	}
+
+	inline void encode(const Header& h, unsigned char* p) {
+		std::memcpy(p, h.magic, 4);
+		put_le(p + 4, h.version, 2);
+		put_le(p + 6, h.width, 2);
+		put_le(p + 8, h.n, 8);
+	}
+
+	inline Header decode(const unsigned char* p) {
+		Header h;
+		std::memcpy(h.magic, p, 4);
+		h.version = get_le(p + 4, 2);
+		h.width = get_le(p + 6, 2);
+		h.n = get_le(p + 8, 8);
+		return h;
+	}
+
+	/// @brief Get the column of each row from an assignment.
+	template <class Assignment>
+	std::vector<uint32_t> columns(const Assignment& a) {
+		std::vector<uint32_t> cols;
+		cols.reserve(a.size());
+		for (auto it = a.begin(); it != a.end(); ++it)
+			cols.push_back(it->value.col);
+		return cols;
+	}
+
+	inline int narrowest_width(uint64_t n) {
+		return n <= 0x100 ? 1 : n <= 0x10000 ? 2 : 4;
+	}
+
+	/// @brief Write all buffers to a file in as few system calls as possible.
+	inline void write_buffers(const fs::path& path, std::initializer_list<std::pair<const void*, size_t>> bufs) {
+#ifdef QUEENS_HAVE_WRITEV
+		int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			throw std::runtime_error("Cannot write file: " + path.string());
+		std::vector<iovec> iov;
+		for (auto [p, n] : bufs)
+			iov.push_back({ const_cast<void*>(p), n });
+		size_t i = 0;
+		while (i < iov.size()) {
+			ssize_t w = ::writev(fd, iov.data() + i, std::min<size_t>(iov.size() - i, IOV_MAX));
+			if (w < 0) {
+				::close(fd);
+				throw std::runtime_error("Write failed: " + path.string());
+			}
+			// Skip fully written buffers and advance into a partially written one
+			size_t done = w;
+			while (i < iov.size() && done >= iov[i].iov_len)
+				done -= iov[i++].iov_len;
+			if (i < iov.size()) {
+				iov[i].iov_base = (char*)iov[i].iov_base + done;
+				iov[i].iov_len -= done;
+			}
+		}
+		::close(fd);
+#else
+		std::ofstream out(path, std::ios::binary);
+		if (out.fail())
+			throw std::runtime_error("Cannot write file: " + path.string());
+		for (auto [p, n] : bufs)
+			out.write((const char*)p, n);
+#endif
+	}
+
+	inline void write_binary(const fs::path& path, const std::vector<uint32_t>& cols) {
+		Header h{ {}, VERSION, (uint16_t)narrowest_width(cols.size()), cols.size() };
+		std::memcpy(h.magic, MAGIC, 4);
+		unsigned char head[HEADER_SIZE];
+		encode(h, head);
+		std::vector<unsigned char> data(cols.size() * h.width);
+		for (size_t i = 0; i < cols.size(); i++)
+			put_le(&data[i * h.width], cols[i], h.width);
+		write_buffers(path, { { head, sizeof(head) }, { data.data(), data.size() } });
+	}
+
+	inline std::string to_text(const std::vector<uint32_t>& cols) {
+		std::string buf(cols.size() * 11 + 1, '\0');
+		char* p = buf.data();
+		for (size_t i = 0; i < cols.size(); i++) {
+			if (i) *p++ = ' ';
+			p = std::to_chars(p, buf.data() + buf.size(), cols[i]).ptr;
+		}
+		*p++ = '\n';
+		buf.resize(p - buf.data());
+		return buf;
+	}
+
+	inline void write_text(const fs::path& path, const std::vector<uint32_t>& cols) {
+		std::string buf = to_text(cols);
+		write_buffers(path, { { buf.data(), buf.size() } });
+	}
+
+	/// @brief Render the board, one row per line, into a single buffer.
+	inline std::string to_board(const std::vector<uint32_t>& cols) {
+		size_t n = cols.size();
+		std::string buf(n * (n + 1), '.');
+		for (size_t i = 0; i < n; i++) {
+			buf[i * (n + 1) + cols[i]] = '@';
+			buf[i * (n + 1) + n] = '\n';
+		}
+		return buf;
+	}
+
+	/// @brief Load a solution file in either format, detected by the header.
+	inline std::vector<uint32_t> read(const fs::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		if (in.fail())
+			throw std::runtime_error("Cannot read file: " + path.string());
+		std::string buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		std::vector<uint32_t> cols;
+		if (buf.size() >= HEADER_SIZE && std::memcmp(buf.data(), MAGIC, 4) == 0) {
+			Header h = decode((const unsigned char*)buf.data());
+			if (h.version != VERSION || (h.width != 1 && h.width != 2 && h.width != 4)
+				|| (buf.size() - HEADER_SIZE) / h.width != h.n || (buf.size() - HEADER_SIZE) % h.width)
+				throw std::runtime_error("Malformed solution file: " + path.string());
+			cols.resize(h.n);
+			auto data = (const unsigned char*)buf.data() + HEADER_SIZE;
+			for (size_t i = 0; i < h.n; i++)
+				cols[i] = get_le(&data[i * h.width], h.width);
+		} else {
+			const char* p = buf.data(), * end = p + buf.size();
+			while (p < end) {
+				while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+				if (p == end) break;
+				uint32_t c;
+				auto r = std::from_chars(p, end, c);
+				if (r.ec != std::errc())
+					throw std::runtime_error("Malformed solution file: " + path.string());
+				cols.push_back(c);
+				p = r.ptr;
+			}
+		}
+		return cols;
+	}
+
+	/// @brief Check in O(n) that the columns form a valid N-queens solution.
+	inline bool verify(const std::vector<uint32_t>& cols) {
+		size_t n = cols.size();
+		std::vector<char> col(n), diag1(2 * n), diag2(2 * n);
+		for (size_t i = 0; i < n; i++) {
+			size_t c = cols[i];
+			if (c >= n || col[c] || diag1[i + c] || diag2[i + n - c])
+				return false;
+			col[c] = diag1[i + c] = diag2[i + n - c] = 1;
+		}
+		return true;
+	}
+
+	inline bool verify_file(const fs::path& path) {
+		return verify(read(path));
+	}
+
+} // namespace solution_io
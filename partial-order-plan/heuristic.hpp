@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace qy::ai
+{
+	/// @brief Delete-relaxation heuristics.
+	enum class Heuristic {
+		ADD,	// Sum of the costs of the goal facts, each the cheapest sum over an achieving action's preconditions
+		MAX,	// Like ADD with max instead of sum; admissible
+		FF,	// Number of actions in a relaxed plan extracted from the ADD best supporters
+	};
+
+	/// @brief Evaluates delete-relaxation heuristics for states of a task.
+	/// A fact is one value of a literal, numbered 2 * literal + value like the bits of a quatset. The
+	/// precondition and effect facts of every action, and the actions waiting on every fact, are listed
+	/// once up front. An evaluation then settles facts in order of cost: each settled fact counts down
+	/// its actions' unsatisfied preconditions, and an action whose count reaches zero offers its
+	/// effects at its cost plus one. It stops as soon as every goal fact is settled.
+	template <class State>
+	class RelaxedHeuristic
+	{
+	public:
+		static constexpr int INF = INT_MAX;
+
+		/// @param actions Actions with preconds and effects states.
+		/// @param literals Number of literals in use.
+		/// @param goal Goal state; its known literals are the goal facts.
+		template <class Action>
+		RelaxedHeuristic(const std::vector<Action>& actions, size_t literals, const State& goal):
+			m_pre(actions.size()), m_add(actions.size()), m_waiting_on(literals * 2), m_is_goal(literals * 2),
+			m_cost(literals * 2), m_supporter(literals * 2), m_unsatisfied(actions.size()),
+			m_action_cost(actions.size()), m_fact_marked(literals * 2), m_action_marked(actions.size())
+		{
+			for (size_t a = 0; a < actions.size(); a++) {
+				m_pre[a] = facts(actions[a].preconds, literals);
+				m_add[a] = facts(actions[a].effects, literals);
+				for (int f : m_pre[a])
+					m_waiting_on[f].push_back(a);
+				if (m_pre[a].empty())
+					m_free.push_back(a);
+			}
+			m_goal = facts(goal, literals);
+			for (int f : m_goal)
+				m_is_goal[f] = 1;
+		}
+
+		/// @return Heuristic value of the state, INF if the goal is unreachable even when relaxed.
+		int operator()(const State& state, Heuristic kind)
+		{
+			std::ranges::fill(m_cost, INF);
+			for (size_t a = 0; a < m_pre.size(); a++) {
+				m_unsatisfied[a] = m_pre[a].size();
+				m_action_cost[a] = 0;
+			}
+			m_queue.clear();
+			for (size_t i = 0; i < m_cost.size() / 2; i++) {
+				if (auto v = state.get(i); v == State::TRUE || v == State::FALSE) {
+					int f = fact(i, v);
+					m_cost[f] = 0;
+					m_queue.emplace_back(0, f);
+				}
+			}
+			std::ranges::make_heap(m_queue, std::greater<>());
+			for (int a : m_free)
+				offer(a);
+
+			int goals = 0;
+			for (int f : m_goal)
+				goals += m_cost[f] == 0;
+			while (!m_queue.empty() && goals < (int)m_goal.size()) {
+				std::ranges::pop_heap(m_queue, std::greater<>());
+				auto [c, f] = m_queue.back();
+				m_queue.pop_back();
+				if (c != m_cost[f]) continue;
+				if (c > 0 && m_is_goal[f])
+					++goals;
+				for (int a : m_waiting_on[f]) {
+					m_action_cost[a] = kind == Heuristic::MAX ? std::max(m_action_cost[a], c) : m_action_cost[a] + c;
+					if (--m_unsatisfied[a] == 0)
+						offer(a);
+				}
+			}
+
+			int h = 0;
+			for (int f : m_goal) {
+				if (m_cost[f] == INF) return INF;
+				h = kind == Heuristic::MAX ? std::max(h, m_cost[f]) : h + m_cost[f];
+			}
+			return kind == Heuristic::FF ? relaxed_plan_size() : h;
+		}
+
+	private:
+		static int fact(size_t literal, int value) {
+			return literal * 2 + (value == State::TRUE);
+		}
+
+		static std::vector<int> facts(const State& s, size_t literals) {
+			std::vector<int> ret;
+			for (size_t i = 0; i < literals; i++) {
+				if (auto v = s.get(i); v == State::TRUE || v == State::FALSE)
+					ret.push_back(fact(i, v));
+			}
+			return ret;
+		}
+
+		void offer(int a) {
+			int c = m_action_cost[a] + 1;
+			for (int f : m_add[a]) {
+				if (c < m_cost[f]) {
+					m_cost[f] = c;
+					m_supporter[f] = a;
+					m_queue.emplace_back(c, f);
+					std::ranges::push_heap(m_queue, std::greater<>());
+				}
+			}
+		}
+
+		/// @brief Count the actions needed to reach the goal facts through their best supporters.
+		int relaxed_plan_size() {
+			int size = 0;
+			std::vector<int> stack = m_goal, touched;
+			while (!stack.empty()) {
+				int f = stack.back();
+				stack.pop_back();
+				if (m_cost[f] == 0 || m_fact_marked[f]) continue;
+				m_fact_marked[f] = 1;
+				touched.push_back(f);
+				int a = m_supporter[f];
+				if (m_action_marked[a]) continue;
+				m_action_marked[a] = 1;
+				++size;
+				stack.insert(stack.end(), m_pre[a].begin(), m_pre[a].end());
+			}
+			for (int f : touched) {
+				m_fact_marked[f] = 0;
+				m_action_marked[m_supporter[f]] = 0;
+			}
+			return size;
+		}
+
+		std::vector<std::vector<int>> m_pre;	// Precondition facts by action
+		std::vector<std::vector<int>> m_add;	// Effect facts by action
+		std::vector<std::vector<int>> m_waiting_on;	// Actions by precondition fact
+		std::vector<int> m_free;	// Actions without preconditions
+		std::vector<int> m_goal;	// Goal facts
+		std::vector<char> m_is_goal;	// By fact
+
+		// Scratch of an evaluation
+		std::vector<int> m_cost;	// By fact
+		std::vector<int> m_supporter;	// Cheapest achieving action by fact
+		std::vector<int> m_unsatisfied;	// By action
+		std::vector<int> m_action_cost;
+		std::vector<char> m_fact_marked;
+		std::vector<char> m_action_marked;
+		std::vector<std::pair<int, int>> m_queue;	// Min-heap of (cost, fact)
+	};
+
+} // namespace qy::ai
@@ -0,0 +1,107 @@
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace qy::ai
+{
+	/// @brief Finds, among a fixed set of partial states, one that a given state includes.
+	/// The states are split on one literal at a time by its value, choosing at each node the literal
+	/// known in most of the node's states. A query follows the UNKNOWN branch and the branches whose
+	/// value its own value includes, so it only reaches states that agree with it on every literal
+	/// along the way. Groups of at most LEAF_SIZE states are tested one by one.
+	template <class State>
+	class InclusionIndex
+	{
+	public:
+		static constexpr size_t LEAF_SIZE = 8;
+
+		/// @param items (state, id) pairs to index.
+		/// @param literals Number of literals in use.
+		void build(std::vector<std::pair<State, int>> items, size_t literals) {
+			m_items = std::move(items);
+			m_scratch.resize(m_items.size());
+			m_nodes.clear();
+			std::vector<char> used(literals, 0);
+			if (!m_items.empty())
+				build(0, m_items.size(), used);
+		}
+
+		/// @return Id of an indexed state that state includes, or -1.
+		int find_included(const State& state) const {
+			if (m_nodes.empty()) return -1;
+			m_stack.assign(1, 0);
+			while (!m_stack.empty()) {
+				const Node& node = m_nodes[m_stack.back()];
+				m_stack.pop_back();
+				if (node.literal < 0) {
+					for (size_t i = node.first; i < node.last; i++) {
+						if (state.includes(m_items[i].first))
+							return m_items[i].second;
+					}
+					continue;
+				}
+				int v = state.get(node.literal);
+				for (int c = 0; c < 4; c++) {
+					if (node.children[c] >= 0 && !(c & ~v))
+						m_stack.push_back(node.children[c]);
+				}
+			}
+			return -1;
+		}
+
+	private:
+		struct Node {
+			int literal;	// Split literal, -1 for leaves
+			size_t first, last;	// Range of the items of a leaf
+			int children[4];	// By value of the literal, -1 if no state has it
+		};
+
+		int build(size_t first, size_t last, std::vector<char>& used) {
+			int id = m_nodes.size();
+			m_nodes.push_back({ -1, first, last, { -1, -1, -1, -1 } });
+			if (last - first <= LEAF_SIZE) return id;
+			int best = -1;
+			size_t best_known = 0;
+			for (size_t i = 0; i < used.size(); i++) {
+				if (used[i]) continue;
+				size_t known = 0;
+				for (size_t k = first; k < last; k++)
+					known += m_items[k].first.get(i) != State::UNKNOWN;
+				if (known > best_known) {
+					best = i;
+					best_known = known;
+				}
+			}
+			// The remaining literals are unknown everywhere, so the states are all equal
+			if (best < 0) return id;
+
+			// Counting sort by the value of the literal
+			size_t bounds[5] = {};
+			for (size_t k = first; k < last; k++)
+				++bounds[m_items[k].first.get(best) + 1];
+			for (int c = 0; c < 4; c++)
+				bounds[c + 1] += bounds[c];
+			size_t next[4] = { bounds[0], bounds[1], bounds[2], bounds[3] };
+			for (size_t k = first; k < last; k++)
+				m_scratch[next[m_items[k].first.get(best)]++] = m_items[k];
+			std::copy(m_scratch.begin(), m_scratch.begin() + (last - first), m_items.begin() + first);
+
+			m_nodes[id].literal = best;
+			used[best] = 1;
+			for (int c = 0; c < 4; c++) {
+				if (bounds[c] == bounds[c + 1]) continue;
+				int child = build(first + bounds[c], first + bounds[c + 1], used);
+				m_nodes[id].children[c] = child;
+			}
+			used[best] = 0;
+			return id;
+		}
+
+		std::vector<std::pair<State, int>> m_items;
+		std::vector<std::pair<State, int>> m_scratch;
+		std::vector<Node> m_nodes;
+		mutable std::vector<int> m_stack;	// Scratch of a query
+	};
+
+} // namespace qy::ai
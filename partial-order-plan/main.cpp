@@ -9,7 +9,8 @@
 
 using namespace qy::ai;
 
-void print_graph(const PartialOrderPlanning& p, const PartialOrderPlanning::GraphType& graph) {
+template <size_t W>
+void print_graph(const PartialOrderPlanning<W>& p, const typename PartialOrderPlanning<W>::GraphType& graph) {
 	for (auto&& [u, e] : graph) {
 		fmt::print("({}) ->\n", p.state_to_string(u));
 		for (auto&& [a, v] : e)
@@ -17,18 +18,21 @@ void print_graph(const PartialOrderPlanning& p, const PartialOrderPlanning::Grap
 	}
 }
 
-void print_actions(const PartialOrderPlanning& p, const PartialOrderPlanning::ResultType& result) {
+template <size_t W>
+void print_actions(const PartialOrderPlanning<W>& p, const typename PartialOrderPlanning<W>::ResultType& result) {
 	fmt::print("{}\n", result | std::views::transform([&p](auto&& t) { return p.get_action(t).name; }));
 }
 
-void print_actions(const PartialOrderPlanning& p, const std::optional<PartialOrderPlanning::ResultType>& result) {
+template <size_t W>
+void print_actions(const PartialOrderPlanning<W>& p, const std::optional<typename PartialOrderPlanning<W>::ResultType>& result) {
 	if (result)
 		print_actions(p, result.value());
 	else
 		fmt::print("No result\n");
 }
 
-void print_chain(const PartialOrderPlanning& p, const PartialOrderPlanning::ResultType& result) {
+template <size_t W>
+void print_chain(const PartialOrderPlanning<W>& p, const typename PartialOrderPlanning<W>::ResultType& result) {
 	auto s = p.init_state();
 	fmt::print("({})", p.state_to_string(s));
 	for (auto&& i : result) {
@@ -50,17 +54,16 @@ int main() {
 	std::ifstream ftasks("data/tasks.txt");
 	for (std::string task; std::getline(ftasks, task); ) {
 		fmt::print(fmt::fg(fmt::color::orange), "Task: {}\n", task);
-		PartialOrderPlanning P;
-		P.read_task(fs::path("data") / task);
-		{
+		// The state width is picked from the number of literals in the task
+		with_planning(fs::path("data") / task, [](auto& P) {
 			fmt::print("Perform forward...\n");
 			// auto ans1 = P.forward_search()
-			auto t = timeit([&]() { return P.forward_search(); }); // Replace with backward
+			auto t = timeit([&]() { return P.forward_search(); }); // Replace with backward, bidirectional, greedy or astar
 			fmt::print(fmt::fg(fmt::color::light_cyan), "[Result] ");
 			fmt::print(fmt::fg(fmt::color::yellow_green), "Duration: {:.3f}ms ", t.count() / 1e6f);
 			fmt::print(fmt::fg(fmt::color::slate_blue), "Nodes generated: {} ", P.log.nodes_generated);
 			fmt::print(fmt::fg(fmt::color::steel_blue), "States generated: {}\n", P.log.nodes_generated);
-		}
+		});
 	}
 	return 0;
 }
\ No newline at end of file
@@ -1,86 +1,121 @@
 #include "planning.hpp"
+#include "inclusion-index.hpp"
 #include <algorithm>
-#include <queue>
+#include <cstdint>
 #include <fstream>
+#include <queue>
+#include <tuple>
 #include <tl/enumerate.hpp>
 #include <nlohmann/json.hpp>
 
 namespace qy::ai
 {
-	int PartialOrderPlanning::literal2id(const std::string& s)
+	int PlanningTask::literal2id(const std::string& s)
+	{
+		if (auto it = std::ranges::find(literals, s); it != literals.end())
+			return it - literals.begin();
+		if (literals.size() >= MAX_LITERALS)
+			throw std::length_error("Too many literals, at most " + std::to_string(MAX_LITERALS) + " are supported");
+		literals.push_back(s);
+		return literals.size() - 1;
+	}
+
+	PlanningTask PlanningTask::read(const fs::path& file)
 	{
-		if (auto it = std::ranges::find(m_literals, s); it != m_literals.end())
-			return it - m_literals.begin();
-		m_literals.push_back(s);
-		return m_literals.size() - 1;
+		using json = nlohmann::json;
+		json root = json::parse(std::ifstream(file));
+		PlanningTask task;
+		for (auto&& v : root["init"])
+			task.init.push_back(task.literal2id(v.get<std::string>()));
+		for (auto&& v : root["goal"])
+			task.goal.push_back(task.literal2id(v.get<std::string>()));
+		for (auto&& v : root["actions"]) {
+			auto& a = task.actions.emplace_back(v["name"].get<std::string>());
+			for (auto&& [k, v] : v["preconds"].items())
+				a.preconds.emplace_back(task.literal2id(k), v.get<bool>());
+			for (auto&& [k, v] : v["effects"].items())
+				a.effects.emplace_back(task.literal2id(k), v.get<bool>());
+		}
+		task.init_omit = !root.contains("initFlag") || root["initFlag"].get<bool>();
+		task.goal_omit = root.contains("goalFlag") && root["goalFlag"].get<bool>();
+		task.backward_strict = !root.contains("backwardStrictEqual") || root["backwardStrictEqual"].get<bool>();
+		return task;
 	}
 
-	std::string PartialOrderPlanning::state_to_string(const State& state) const
+	template <size_t W>
+	std::string PartialOrderPlanning<W>::state_to_string(const State& state) const
 	{
 		std::string s;
 		for (size_t i = 0; i < m_literals.size(); i++) {
 			auto x = state.get(i);
-			if (x == quatset::UNKNOWN) continue;
-			if (x == quatset::TRUE) s += '+';
-			else if (x == quatset::FALSE)s += '-';
+			if (x == State::UNKNOWN) continue;
+			if (x == State::TRUE) s += '+';
+			else if (x == State::FALSE)s += '-';
 			s += m_literals[i];
 		}
 		return s;
 	}
 
-	void PartialOrderPlanning::read_task(const fs::path& file)
+	template <size_t W>
+	void PartialOrderPlanning<W>::load(const PlanningTask& task)
 	{
-		using json = nlohmann::json;
-		json root = json::parse(std::ifstream(file));
-		for (auto&& v : root["init"])
-			m_init_state.set(literal2id(v.get<std::string>()));
-		for (auto&& v : root["goal"])
-			m_goal_state.set(literal2id(v.get<std::string>()));
-		for (auto&& v : root["actions"]) {
-			auto& a = m_actions.emplace_back(v["name"].get<std::string>(), 0, 0, 0, 0);
-			for (auto&& [k, v] : v["preconds"].items()) {
-				int i = literal2id(k);
-				a.preconds.setb(i, v.get<bool>());
-				a.preconds_mask.set(i, quatset::BOTH);
+		if (task.literals.size() > State::capacity)
+			throw std::length_error("Task has " + std::to_string(task.literals.size()) + " literals, state holds " + std::to_string(State::capacity));
+		m_literals = task.literals;
+		m_init_state = m_goal_state = {};
+		for (int i : task.init)
+			m_init_state.set(i);
+		for (int i : task.goal)
+			m_goal_state.set(i);
+		m_actions.clear();
+		for (auto&& t : task.actions) {
+			auto& a = m_actions.emplace_back(t.name, 0, 0, 0, 0);
+			for (auto&& [i, v] : t.preconds) {
+				a.preconds.setb(i, v);
+				a.preconds_mask.set(i, State::BOTH);
 			}
-			for (auto&& [k, v] : v["effects"].items()) {
-				int i = literal2id(k);
-				a.effects.setb(i, v.get<bool>());
-				a.effects_mask.set(i, quatset::BOTH);
+			for (auto&& [i, v] : t.effects) {
+				a.effects.setb(i, v);
+				a.effects_mask.set(i, State::BOTH);
 			}
 		}
-		m_init_omit = !root.contains("initFlag") || root["initFlag"].get<bool>();
-		m_goal_omit = root.contains("goalFlag") && root["goalFlag"].get<bool>();
-		m_backward_strict = !root.contains("backwardStrictEqual") || root["backwardStrictEqual"].get<bool>();
+		m_init_omit = task.init_omit;
+		m_goal_omit = task.goal_omit;
+		m_backward_strict = task.backward_strict;
 	}
 
-	PartialOrderPlanning::ResultType PartialOrderPlanning::backtrack(const std::vector<Node>& nodes, int cur_idx, bool reversed) const
+	template <size_t W>
+	PartialOrderPlanning<W>::ResultType PartialOrderPlanning<W>::backtrack(const StateTable<State>& nodes, int cur_idx, bool reversed) const
 	{
 		ResultType ans;
-		for (int i = cur_idx; i != 0; i = nodes[i].prev)
-			ans.emplace_back(nodes[i].act);
+		for (int i = cur_idx; i != 0; i = nodes.prev(i))
+			ans.emplace_back(nodes.act(i));
 		if (reversed)
 			std::ranges::reverse(ans);
 		return ans;
 	}
 
-	std::optional<PartialOrderPlanning::ResultType> PartialOrderPlanning::forward_search() const
+	template <size_t W>
+	size_t PartialOrderPlanning<W>::estimated_states() const
+	{
+		// Every literal at most doubles the reachable states; the table grows past this if needed
+		return size_t(1) << std::min<size_t>(m_literals.size(), 16);
+	}
+
+	template <size_t W>
+	std::optional<typename PartialOrderPlanning<W>::ResultType> PartialOrderPlanning<W>::forward_search() const
 	{
 		log.clear();
 		// Full initial state
 		State init_state = m_init_omit ? m_init_state.unk_as_false(m_literals.size()) : m_init_state;
 
-		std::vector<Node> nodes{ {init_state, -1, -1} }; // Store all generated nodes
-
-		std::queue<int> open{ {0} };
-		std::set<State> close{ nodes[0].state };
+		StateTable<State> nodes(estimated_states()); // Store all generated nodes, in the order they are expanded
+		nodes.insert(init_state, -1, -1);
 
 		log.nodes_generated = log.states_generated = 1;
 
-		while (!open.empty()) {
-			int cur_idx = open.front();
-			State cur_state = nodes[cur_idx].state;
-			open.pop();
+		for (int cur_idx = 0; cur_idx < (int)nodes.size(); cur_idx++) {
+			State cur_state = nodes.state(cur_idx);
 			if (cur_state.includes(m_goal_state))
 				return backtrack(nodes, cur_idx, true);
 			// Extend
@@ -92,34 +127,27 @@ namespace qy::ai
 				State next_state = cur_state.modified(action.effects, action.effects_mask);
 				++log.states_generated;
 				// Enqueue
-				if (!close.contains(next_state)) {
-					open.push(nodes.size());
-					nodes.emplace_back(next_state, i, cur_idx);
-					close.insert(next_state);
+				if (nodes.insert(next_state, i, cur_idx).second)
 					++log.nodes_generated;
-				}
 			}
 		}
 		return std::nullopt;
 	}
 
-	std::optional<PartialOrderPlanning::ResultType> PartialOrderPlanning::backward_search() const
+	template <size_t W>
+	std::optional<typename PartialOrderPlanning<W>::ResultType> PartialOrderPlanning<W>::backward_search() const
 	{
 		log.clear();
 		// Full goal state
 		State goal_state = m_goal_omit ? m_goal_state.unk_as_false(m_literals.size()) : m_goal_state;
 
-		std::vector<Node> nodes{ {goal_state, -1, -1} }; // Store all generated nodes
-
-		std::queue<int> open{ {0} };
-		std::set<State> close{ nodes[0].state };
+		StateTable<State> nodes(estimated_states()); // Store all generated nodes, in the order they are expanded
+		nodes.insert(goal_state, -1, -1);
 
 		log.nodes_generated = log.states_generated = 1;
 
-		while (!open.empty()) {
-			int cur_idx = open.front();
-			State cur_state = nodes[cur_idx].state;
-			open.pop();
+		for (int cur_idx = 0; cur_idx < (int)nodes.size(); cur_idx++) {
+			State cur_state = nodes.state(cur_idx);
 			if ((m_backward_strict && cur_state == m_init_state) || (!m_backward_strict && cur_state.includes(m_init_state)))
 				return backtrack(nodes, cur_idx, false);
 			// Extend
@@ -132,32 +160,194 @@ namespace qy::ai
 				State prev_state = (cur_state & ~action.effects_mask).modified(action.preconds, action.preconds_mask);
 				++log.states_generated;
 				// Enqueue
-				if (!close.contains(prev_state)) {
-					open.push(nodes.size());
-					nodes.emplace_back(prev_state, i, cur_idx);
-					close.insert(prev_state);
+				if (nodes.insert(prev_state, i, cur_idx).second)
 					++log.nodes_generated;
-				}
 			}
 		}
 		return std::nullopt;
 	}
 
-	PartialOrderPlanning::GraphType PartialOrderPlanning::forward_search_g() const
+	template <size_t W>
+	std::optional<typename PartialOrderPlanning<W>::ResultType> PartialOrderPlanning<W>::bidirectional_search() const
 	{
+		log.clear();
 		State init_state = m_init_omit ? m_init_state.unk_as_false(m_literals.size()) : m_init_state;
 
-		std::vector<Node> nodes{ {init_state, -1, -1} }; // Store all generated nodes
+		// Regress from the goal as given, so that a plan ends in a state forward_search would stop at
+		StateTable<State> forward(estimated_states()), backward(estimated_states());
+		forward.insert(init_state, -1, -1);
+		backward.insert(m_goal_state, -1, -1);
 
-		std::queue<int> open{ {0} };
-		std::set<State> close{ nodes[0].state };
+		// A new state only has to be tested against the other side's frontier: if an expanded state X
+		// meets a new state Y, the step from X along Y's path yields a state that meets Y's parent, a
+		// pair that was complete, and so tested, before Y was added. The backward frontier does not
+		// change during a forward layer, so it is indexed for inclusion queries; a new backward state
+		// is tested against every forward frontier state. Both return the meeting pair
+		// (forward node, backward node), or (-1, -1).
+		size_t fhead = 0, bhead = 0;
+		InclusionIndex<State> frontier;
+		size_t indexed_from = SIZE_MAX, indexed_to = 0;	// Backward nodes in frontier
+		auto meet_forward = [&](int f) -> std::pair<int, int> {
+			if (int b = frontier.find_included(forward.state(f)); b >= 0)
+				return { f, b };
+			return { -1, -1 };
+		};
+		auto meet_backward = [&](int b) -> std::pair<int, int> {
+			for (size_t f = fhead; f < forward.size(); f++) {
+				if (forward.state(f).includes(backward.state(b)))
+					return { (int)f, b };
+			}
+			return { -1, -1 };
+		};
 
-		std::map<State, std::map<int, State>> graph;
+		log.nodes_generated = log.states_generated = 2;
+		auto meeting = meet_backward(0);
+		// Expand a whole layer at a time, on the side with the smaller frontier
+		while (meeting.first < 0 && fhead < forward.size() && bhead < backward.size()) {
+			if (forward.size() - fhead <= backward.size() - bhead) {
+				if (indexed_from != bhead || indexed_to != backward.size()) {
+					std::vector<std::pair<State, int>> items;
+					for (size_t b = bhead; b < backward.size(); b++)
+						items.emplace_back(backward.state(b), b);
+					frontier.build(std::move(items), m_literals.size());
+					indexed_from = bhead;
+					indexed_to = backward.size();
+				}
+				for (size_t end = forward.size(); fhead < end && meeting.first < 0; fhead++) {
+					State cur_state = forward.state(fhead);
+					for (auto&& [i, action] : tl::views::enumerate(m_actions)) {
+						if (!cur_state.includes(action.preconds))
+							continue;
+						State next_state = cur_state.modified(action.effects, action.effects_mask);
+						++log.states_generated;
+						if (auto [id, added] = forward.insert(next_state, i, fhead); added) {
+							++log.nodes_generated;
+							if ((meeting = meet_forward(id)).first >= 0)
+								break;
+						}
+					}
+				}
+			} else {
+				for (size_t end = backward.size(); bhead < end && meeting.first < 0; bhead++) {
+					State cur_state = backward.state(bhead);
+					for (auto&& [i, action] : tl::views::enumerate(m_actions)) {
+						// Effects must establish the state, and preconditions must not contradict what
+						// the action leaves untouched, so every stitched plan is executable
+						if ((cur_state & action.effects_mask) & ~action.effects)
+							continue;
+						State kept = cur_state & ~action.effects_mask;
+						if ((kept & action.preconds_mask) & ~action.preconds)
+							continue;
+						State prev_state = kept.modified(action.preconds, action.preconds_mask);
+						++log.states_generated;
+						if (auto [id, added] = backward.insert(prev_state, i, bhead); added) {
+							++log.nodes_generated;
+							if ((meeting = meet_backward(id)).first >= 0)
+								break;
+						}
+					}
+				}
+			}
+		}
+		if (meeting.first < 0)
+			return std::nullopt;
+		ResultType ans = backtrack(forward, meeting.first, true);
+		ResultType rest = backtrack(backward, meeting.second, false);
+		ans.insert(ans.end(), rest.begin(), rest.end());
+		return ans;
+	}
+
+	template <size_t W>
+	std::optional<typename PartialOrderPlanning<W>::ResultType> PartialOrderPlanning<W>::greedy_search(Heuristic heuristic) const
+	{
+		return best_first_search(heuristic, 0, 1);
+	}
+
+	template <size_t W>
+	std::optional<typename PartialOrderPlanning<W>::ResultType> PartialOrderPlanning<W>::astar_search(Heuristic heuristic, double weight) const
+	{
+		return best_first_search(heuristic, 1, weight);
+	}
+
+	template <size_t W>
+	std::optional<typename PartialOrderPlanning<W>::ResultType> PartialOrderPlanning<W>::best_first_search(Heuristic heuristic, double g_weight, double h_weight) const
+	{
+		using H = RelaxedHeuristic<State>;
+		log.clear();
+		State init_state = m_init_omit ? m_init_state.unk_as_false(m_literals.size()) : m_init_state;
+		H evaluate(m_actions, m_literals.size(), m_goal_state);
+
+		StateTable<State> nodes(estimated_states()); // Store all generated nodes
+		std::vector<int> g, h;	// By node
+
+		struct Entry {
+			double f;
+			int h;
+			int g;
+			int id;
+			// Lowest f first, ties to lower h, then to the earlier node
+			bool operator< (const Entry& o) const {
+				return std::tie(o.f, o.h, o.id) < std::tie(f, h, id);
+			}
+		};
+		std::priority_queue<Entry> open;
+
+		nodes.insert(init_state, -1, -1);
+		g.push_back(0);
+		h.push_back(evaluate(init_state, heuristic));
+		if (h[0] != H::INF)
+			open.push({ h_weight * h[0], h[0], 0, 0 });
+		log.nodes_generated = log.states_generated = 1;
 
 		while (!open.empty()) {
-			int cur_idx = open.front();
-			State cur_state = nodes[cur_idx].state;
+			Entry cur = open.top();
 			open.pop();
+			// Skip entries superseded by a cheaper path
+			if (cur.g != g[cur.id]) continue;
+			State cur_state = nodes.state(cur.id);
+			if (cur_state.includes(m_goal_state))
+				return backtrack(nodes, cur.id, true);
+			// Extend
+			for (auto&& [i, action] : tl::views::enumerate(m_actions)) {
+				// Check if all preconditions are satisfied
+				if (!cur_state.includes(action.preconds))
+					continue;
+				// Apply effects
+				State next_state = cur_state.modified(action.effects, action.effects_mask);
+				++log.states_generated;
+				int next_g = cur.g + 1;
+				auto [id, added] = nodes.insert(next_state, i, cur.id);
+				if (added) {
+					++log.nodes_generated;
+					g.push_back(next_g);
+					h.push_back(evaluate(next_state, heuristic));
+				} else if (g_weight > 0 && next_g < g[id]) {
+					// Shorter path to a generated node: relink it and queue it again with the lower g,
+					// reopening it if it was expanded. Greedy search ignores g and never gets here.
+					g[id] = next_g;
+					nodes.relink(id, i, cur.id);
+				} else {
+					continue;
+				}
+				if (h[id] != H::INF)
+					open.push({ g_weight * next_g + h_weight * h[id], h[id], next_g, id });
+			}
+		}
+		return std::nullopt;
+	}
+
+	template <size_t W>
+	PartialOrderPlanning<W>::GraphType PartialOrderPlanning<W>::forward_search_g() const
+	{
+		State init_state = m_init_omit ? m_init_state.unk_as_false(m_literals.size()) : m_init_state;
+
+		StateTable<State> nodes(estimated_states()); // Store all generated nodes, in the order they are expanded
+		nodes.insert(init_state, -1, -1);
+
+		std::map<State, std::map<int, State>> graph;
+
+		for (int cur_idx = 0; cur_idx < (int)nodes.size(); cur_idx++) {
+			State cur_state = nodes.state(cur_idx);
 			// Extend
 			for (auto&& [i, action] : tl::views::enumerate(m_actions)) {
 				// Check if all preconditions are satisfied
@@ -166,15 +356,16 @@ namespace qy::ai
 				// Apply effects
 				State next_state = cur_state.modified(action.effects, action.effects_mask);
 				// Enqueue
-				if (!close.contains(next_state)) {
-					open.push(nodes.size());
-					nodes.emplace_back(next_state, i, cur_idx);
-					close.insert(next_state);
+				if (nodes.insert(next_state, i, cur_idx).second)
 					graph[cur_state][i] = next_state;
-				}
 			}
 		}
 		return graph;
 	}
 
+	template class PartialOrderPlanning<1>;
+	template class PartialOrderPlanning<2>;
+	template class PartialOrderPlanning<4>;
+	template class PartialOrderPlanning<8>;
+
 } // namespace qy::ai
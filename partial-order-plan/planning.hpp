@@ -1,31 +1,61 @@
 #pragma once
+#include "heuristic.hpp"
 #include "quatset.hpp"
+#include "state-table.hpp"
 #include <string>
 #include <vector>
 #include <map>
-#include <set>
 #include <filesystem>
 #include <optional>
+#include <stdexcept>
+#include <utility>
 
 namespace fs = std::filesystem;
 
 namespace qy::ai
 {
-	struct Action {
-		std::string name;
-		quatset preconds;
-		quatset preconds_mask;
-		quatset effects;
-		quatset effects_mask;
+	/// @brief Planning task as read from JSON, with literals numbered but not yet packed into states.
+	struct PlanningTask {
+		struct Action {
+			std::string name;
+			std::vector<std::pair<int, bool>> preconds;	// (literal, value)
+			std::vector<std::pair<int, bool>> effects;
+		};
+
+		static constexpr size_t MAX_LITERALS = quatset<8>::capacity;
+
+		std::vector<std::string> literals;	// Names by id
+		std::vector<int> init;	// Literals true in the initial state
+		std::vector<int> goal;	// Literals true in the goal state
+		std::vector<Action> actions;
+		bool init_omit;
+		bool goal_omit;
+		bool backward_strict;
+
+		int literal2id(const std::string& s);
+
+		/// @brief Read planning task from JSON file.
+		/// @param file Path of the file.
+		static PlanningTask read(const fs::path& file);
 	};
 
+	/// @brief Planner over states of W words, holding up to 32 * W literals.
+	template <size_t W = 1>
 	class PartialOrderPlanning
 	{
 	public:
-		using State = quatset;
+		using State = quatset<W>;
 		using ResultType = std::vector<int>;	// Type of search result
 		using GraphType = std::map<State, std::map<int, State>>;
 
+		struct Action {
+			std::string name;
+			State preconds;
+			State preconds_mask;
+			State effects;
+			State effects_mask;
+		};
+
 		struct Log {
 			int states_generated;
 			int nodes_generated;
@@ -36,13 +66,6 @@ namespace qy::ai
 		};
 		mutable Log log;
 
-		struct Node {
-			State state;
-			int act;	// Index of preformed action
-			int prev;	// Index of previous node
-		};
-
-		int literal2id(const std::string& s);
 		std::string state_to_string(const State& state) const;
 
 		inline const Action& get_action(int i) const { return m_actions[i]; }
@@ -51,14 +74,30 @@ namespace qy::ai
 
 		/// @brief Read planning task from JSON file.
 		/// @param file Path of the file.
-		void read_task(const fs::path& file);
+		void read_task(const fs::path& file) { load(PlanningTask::read(file)); }
+
+		/// @brief Pack a parsed task into states.
+		/// @throw std::length_error if the task has more literals than a state holds.
+		void load(const PlanningTask& task);
 
 		std::optional<ResultType> forward_search() const;
 		std::optional<ResultType> backward_search() const;
+		/// @brief Alternate forward and backward breadth-first layers until a forward state includes
+		/// a regressed backward state, then join the two paths into one plan. The backward side starts
+		/// from the goal as given, matching the stopping test of forward_search even when goalFlag is set.
+		std::optional<ResultType> bidirectional_search() const;
 		GraphType forward_search_g() const;
 
+		/// @brief Greedy best-first search, expanding the state with the lowest heuristic value.
+		std::optional<ResultType> greedy_search(Heuristic heuristic = Heuristic::FF) const;
+		/// @brief A* search on g + weight * h. The plan is optimal when weight is 1 and the heuristic is
+		/// MAX; larger weights trade plan length for fewer expansions.
+		std::optional<ResultType> astar_search(Heuristic heuristic = Heuristic::MAX, double weight = 1) const;
+
 	private:
-		ResultType backtrack(const std::vector<Node>& nodes, int cur_idx, bool reversed = false) const;
+		ResultType backtrack(const StateTable<State>& nodes, int cur_idx, bool reversed = false) const;
+		size_t estimated_states() const;
+		std::optional<ResultType> best_first_search(Heuristic heuristic, double g_weight, double h_weight) const;
 
 		State m_init_state;
 		State m_goal_state;
@@ -70,4 +109,30 @@ namespace qy::ai
 		std::vector<std::string> m_literals;
 	};
 
+	extern template class PartialOrderPlanning<1>;
+	extern template class PartialOrderPlanning<2>;
+	extern template class PartialOrderPlanning<4>;
+	extern template class PartialOrderPlanning<8>;
+
+	/// @brief Read a task and call fn with a planner of the narrowest width that holds its literals,
+	/// so small domains keep the single-word fast path.
+	template <class Fn>
+	decltype(auto) with_planning(const fs::path& file, Fn&& fn)
+	{
+		PlanningTask task = PlanningTask::read(file);
+		auto run = [&]<size_t W>() -> decltype(auto) {
+			PartialOrderPlanning<W> planning;
+			planning.load(task);
+			return fn(planning);
+		};
+		size_t n = task.literals.size();
+		if (n <= quatset<1>::capacity)
+			return run.template operator()<1>();
+		if (n <= quatset<2>::capacity)
+			return run.template operator()<2>();
+		if (n <= quatset<4>::capacity)
+			return run.template operator()<4>();
+		return run.template operator()<8>();
+	}
+
 } // namespace qy::ai
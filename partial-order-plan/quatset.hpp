@@ -1,79 +1,216 @@
+#pragma once
+#include <array>
 #include <compare>
+#include <cstddef>
 #include <cstdint>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
 
 namespace qy
 {
+	namespace detail
+	{
+		/// @brief One 64-bit word per lane, the fallback for odd widths.
+		struct scalar_lanes {
+			using reg = uint64_t;
+			static constexpr size_t words = 1;
+			static reg load(const uint64_t* p) { return *p; }
+			static void store(uint64_t* p, reg x) { *p = x; }
+			static reg and_(reg a, reg b) { return a & b; }
+			static reg or_(reg a, reg b) { return a | b; }
+			static reg andnot(reg a, reg b) { return ~a & b; }
+			static reg not_(reg a) { return ~a; }
+			static reg srl1(reg a) { return a >> 1; }
+			static reg sll1(reg a) { return a << 1; }
+			static reg zero() { return 0; }
+			static reg set1(uint64_t v) { return v; }
+			static bool is_zero(reg a) { return !a; }
+		};
+
+#if defined(__SSE2__) || defined(_M_X64)
+		/// @brief Two words per lane.
+		struct sse2_lanes {
+			using reg = __m128i;
+			static constexpr size_t words = 2;
+			static reg load(const uint64_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+			static void store(uint64_t* p, reg x) { _mm_storeu_si128((__m128i*)p, x); }
+			static reg and_(reg a, reg b) { return _mm_and_si128(a, b); }
+			static reg or_(reg a, reg b) { return _mm_or_si128(a, b); }
+			static reg andnot(reg a, reg b) { return _mm_andnot_si128(a, b); }
+			static reg not_(reg a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+			static reg srl1(reg a) { return _mm_srli_epi64(a, 1); }
+			static reg sll1(reg a) { return _mm_slli_epi64(a, 1); }
+			static reg zero() { return _mm_setzero_si128(); }
+			static reg set1(uint64_t v) { return _mm_set1_epi64x(v); }
+			static bool is_zero(reg a) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, zero())) == 0xffff; }
+		};
+#endif
+
+#if defined(__AVX2__)
+		/// @brief Four words per lane.
+		struct avx2_lanes {
+			using reg = __m256i;
+			static constexpr size_t words = 4;
+			static reg load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+			static void store(uint64_t* p, reg x) { _mm256_storeu_si256((__m256i*)p, x); }
+			static reg and_(reg a, reg b) { return _mm256_and_si256(a, b); }
+			static reg or_(reg a, reg b) { return _mm256_or_si256(a, b); }
+			static reg andnot(reg a, reg b) { return _mm256_andnot_si256(a, b); }
+			static reg not_(reg a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+			static reg srl1(reg a) { return _mm256_srli_epi64(a, 1); }
+			static reg sll1(reg a) { return _mm256_slli_epi64(a, 1); }
+			static reg zero() { return _mm256_setzero_si256(); }
+			static reg set1(uint64_t v) { return _mm256_set1_epi64x(v); }
+			static bool is_zero(reg a) { return _mm256_testz_si256(a, a); }
+		};
+#endif
+
+		/// @brief Widest lanes that evenly divide W words.
+		template <size_t W>
+		auto select_lanes() {
+#if defined(__AVX2__)
+			if constexpr (W % 4 == 0) return avx2_lanes{}; else
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+			if constexpr (W % 2 == 0) return sse2_lanes{}; else
+#endif
+			return scalar_lanes{};
+		}
+
+		template <size_t W>
+		using lanes_for = decltype(select_lanes<W>());
+
+	} // namespace detail
+
+	/// @brief Set of 4-valued literals, 2 bits each, packed into W 64-bit words (32 literals a word).
+	/// Bitwise operations run on the widest SIMD lanes that divide W; quatset<1> is a plain uint64_t.
+	template <size_t W = 1>
 	class quatset
 	{
+		using lanes = detail::lanes_for<W>;
+
 	public:
 		using value_type = uint64_t;
-		using index_t = uint8_t;
+		using index_t = uint32_t;
 		using bits_t = uint8_t;
 
+		static constexpr size_t words = W;
+		static constexpr size_t capacity = W * 32;	// Number of literals
+
 		enum {
 			UNKNOWN = 0b00, FALSE = 0b01, TRUE = 0b10, BOTH = 0b11
 		};
 
-		quatset(value_type v = 0): m_bitset(v) {}
+		quatset(value_type v = 0): m_words{ v } {}
 
 		inline bits_t get(index_t i) const {
-			i <<= 1;
-			return (m_bitset >> i) & 0b11;
+			return (m_words[i >> 5] >> ((i & 31) << 1)) & 0b11;
 		}
 
 		inline void set(index_t i, bits_t value = TRUE) {
-			i <<= 1;
-			m_bitset &= ~((value_type)0b11 << i);
-			m_bitset |= (value_type)(value & 0b11) << i;
+			value_type& w = m_words[i >> 5];
+			index_t s = (i & 31) << 1;
+			w &= ~((value_type)0b11 << s);
+			w |= (value_type)(value & 0b11) << s;
 		}
 
 		inline void setb(index_t i, bool value = true) {
 			set(i, (bits_t)value + 1);
 		}
 
-		inline void modify(quatset value, quatset mask) {
-			m_bitset = (m_bitset & ~mask.m_bitset) | value.m_bitset;
+		inline void modify(const quatset& value, const quatset& mask) {
+			*this = modified(value, mask);
 		}
 
-		inline quatset modified(quatset value, quatset mask) const {
-			return { (m_bitset & ~mask.m_bitset) | value.m_bitset };
+		inline quatset modified(const quatset& value, const quatset& mask) const {
+			quatset ret;
+			for (size_t i = 0; i < W; i += lanes::words) {
+				auto x = lanes::andnot(lanes::load(&mask.m_words[i]), lanes::load(&m_words[i]));
+				lanes::store(&ret.m_words[i], lanes::or_(x, lanes::load(&value.m_words[i])));
+			}
+			return ret;
 		}
 
-		inline bool includes(quatset other) const {
-			return (m_bitset & other.m_bitset) == other.m_bitset;
+		inline bool includes(const quatset& other) const {
+			auto missing = lanes::zero();
+			for (size_t i = 0; i < W; i += lanes::words)
+				missing = lanes::or_(missing, lanes::andnot(lanes::load(&m_words[i]), lanes::load(&other.m_words[i])));
+			return lanes::is_zero(missing);
 		}
 
+		/// @brief Set the unknown literals among the first nbits to false.
 		inline quatset unk_as_false(index_t nbits) const {
-			quatset ret = *this;
-			for (index_t i = 0; i < nbits; i++)
-				if (!ret.get(i))
-					ret.set(i, FALSE);
+			// Low bit of every literal in range
+			quatset low;
+			for (size_t i = 0; i < W; i++) {
+				index_t n = nbits > i * 32 ? nbits - i * 32 : 0;
+				low.m_words[i] = n >= 32 ? 0x5555555555555555ULL : 0x5555555555555555ULL & (((value_type)1 << (n << 1)) - 1);
+			}
+			quatset ret;
+			for (size_t i = 0; i < W; i += lanes::words) {
+				auto x = lanes::load(&m_words[i]);
+				auto unknown = lanes::andnot(lanes::or_(x, lanes::srl1(x)), lanes::load(&low.m_words[i]));
+				lanes::store(&ret.m_words[i], lanes::or_(x, unknown));
+			}
+			return ret;
+		}
+
+		/// @brief BOTH at every literal that is not UNKNOWN, UNKNOWN elsewhere.
+		inline quatset known() const {
+			quatset ret;
+			auto low = lanes::set1(0x5555555555555555ULL);
+			for (size_t i = 0; i < W; i += lanes::words) {
+				auto x = lanes::load(&m_words[i]);
+				auto any = lanes::and_(lanes::or_(x, lanes::srl1(x)), low);
+				lanes::store(&ret.m_words[i], lanes::or_(any, lanes::sll1(any)));
+			}
 			return ret;
 		}
 
 		inline quatset operator~ () const {
-			return { ~m_bitset };
+			quatset ret;
+			for (size_t i = 0; i < W; i += lanes::words)
+				lanes::store(&ret.m_words[i], lanes::not_(lanes::load(&m_words[i])));
+			return ret;
 		}
 
-		inline quatset operator& (quatset other) const {
-			return { m_bitset & other.m_bitset };
+		inline quatset operator& (const quatset& other) const {
+			quatset ret;
+			for (size_t i = 0; i < W; i += lanes::words)
+				lanes::store(&ret.m_words[i], lanes::and_(lanes::load(&m_words[i]), lanes::load(&other.m_words[i])));
+			return ret;
 		}
 
-		inline quatset operator| (quatset other) const {
-			return { m_bitset | other.m_bitset };
+		inline quatset operator| (const quatset& other) const {
+			quatset ret;
+			for (size_t i = 0; i < W; i += lanes::words)
+				lanes::store(&ret.m_words[i], lanes::or_(lanes::load(&m_words[i]), lanes::load(&other.m_words[i])));
+			return ret;
 		}
 
 		inline operator bool() const {
-			return m_bitset;
+			auto any = lanes::zero();
+			for (size_t i = 0; i < W; i += lanes::words)
+				any = lanes::or_(any, lanes::load(&m_words[i]));
+			return !lanes::is_zero(any);
+		}
+
+		/// @brief Hash of the words, for hash tables of states.
+		inline uint64_t hash() const {
+			uint64_t h = 0;
+			for (value_type w : m_words) {
+				h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+				h ^= h >> 32;
+			}
+			return h * 0xbf58476d1ce4e5b9ULL ^ (h >> 29);
 		}
 
 		bool operator== (const quatset& other) const = default;
 		auto operator<=> (const quatset& other) const = default;
 
 	private:
-		value_type m_bitset;
+		std::array<value_type, W> m_words;
 	};
 
 } // namespace qy
-
-
@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace qy::ai
+{
+	/// @brief Closed set and node store of a search, in insertion order.
+	/// States, and the action and parent that generated them, live in parallel arrays indexed by node
+	/// id. Duplicates are found through an open-addressing index of (hash, id) slots with linear
+	/// probing, kept at most half full; it doubles when needed, reusing the stored hashes so states
+	/// are never hashed twice. Since a breadth-first search appends nodes in the order it expands
+	/// them, node ids double as its queue.
+	template <class State>
+	class StateTable
+	{
+	public:
+		static constexpr uint32_t EMPTY = UINT32_MAX;
+
+		/// @param expected Number of states to size the arrays and index for.
+		explicit StateTable(size_t expected = 1024) {
+			reserve(expected);
+		}
+
+		void reserve(size_t expected) {
+			m_states.reserve(expected);
+			m_links.reserve(expected);
+			size_t capacity = std::bit_ceil(std::max<size_t>(16, expected * 2));
+			if (capacity > m_slots.size())
+				rehash(capacity);
+		}
+
+		/// @brief Add a state unless already present.
+		/// @return Id of the state and whether it was added.
+		std::pair<int, bool> insert(const State& state, int act, int prev) {
+			if ((m_states.size() + 1) * 2 > m_slots.size())
+				rehash(m_slots.size() * 2);
+			uint32_t h = state.hash() >> 32;
+			size_t mask = m_slots.size() - 1;
+			for (size_t i = h & mask; ; i = (i + 1) & mask) {
+				Slot& slot = m_slots[i];
+				if (slot.id == EMPTY) {
+					slot = { h, (uint32_t)m_states.size() };
+					m_states.push_back(state);
+					m_links.push_back({ act, prev });
+					return { slot.id, true };
+				}
+				if (slot.hash == h && m_states[slot.id] == state)
+					return { slot.id, false };
+			}
+		}
+
+		/// @return Id of the state, or -1 if absent.
+		int find(const State& state) const {
+			uint32_t h = state.hash() >> 32;
+			size_t mask = m_slots.size() - 1;
+			for (size_t i = h & mask; m_slots[i].id != EMPTY; i = (i + 1) & mask) {
+				if (m_slots[i].hash == h && m_states[m_slots[i].id] == state)
+					return m_slots[i].id;
+			}
+			return -1;
+		}
+
+		bool contains(const State& state) const { return find(state) >= 0; }
+
+		inline size_t size() const { return m_states.size(); }
+		inline const State& state(int i) const { return m_states[i]; }
+		inline int act(int i) const { return m_links[i].act; }	// Index of preformed action
+		inline int prev(int i) const { return m_links[i].prev; }	// Id of previous node
+
+		/// @brief Record a cheaper way to reach a node.
+		inline void relink(int i, int act, int prev) { m_links[i] = { act, prev }; }
+
+	private:
+		struct Slot {
+			uint32_t hash;
+			uint32_t id;
+		};
+
+		struct Link {
+			int act;
+			int prev;
+		};
+
+		void rehash(size_t capacity) {
+			std::vector<Slot> slots(capacity, { 0, EMPTY });
+			size_t mask = capacity - 1;
+			for (auto&& s : m_slots) {
+				if (s.id == EMPTY) continue;
+				size_t i = s.hash & mask;
+				while (slots[i].id != EMPTY)
+					i = (i + 1) & mask;
+				slots[i] = s;
+			}
+			m_slots = std::move(slots);
+		}
+
+		std::vector<State> m_states;
+		std::vector<Link> m_links;
+		std::vector<Slot> m_slots;
+	};
+
+} // namespace qy::ai